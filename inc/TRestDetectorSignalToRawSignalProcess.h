@@ -23,11 +23,17 @@
 #ifndef RestCore_TRestDetectorSignalToRawSignalProcess
 #define RestCore_TRestDetectorSignalToRawSignalProcess
 
+#include <TGraph.h>
 #include <TRestDetectorReadout.h>
 #include <TRestDetectorSignalEvent.h>
 #include <TRestEventProcess.h>
 #include <TRestRawSignalEvent.h>
 
+#include <complex>
+#include <deque>
+#include <functional>
+#include <memory>
+
 //! A process to convert a TRestDetectorSignalEvent into a TRestRawSignalEvent
 class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
    private:
@@ -39,6 +45,59 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
 
     TRestDetectorReadout* fReadout = nullptr;  //!
 
+    /// The trigger time found by the integralThresholdTPC trigger mode (triggerTimeTPC observable)
+    Double_t fTriggerTime = 0;  //!
+
+    /// The event used to synthesize the trigger windows after the first one
+    TRestRawSignalEvent* fWindowEvent = nullptr;  //!
+
+    /// The start times (before the trigger delay) of the trigger windows of the current event
+    std::vector<Double_t> fTriggerWindowTimes;  //!
+
+    /// A deposit of the stream, at a stream time
+    struct StreamDeposit {
+        Double_t time;
+        Int_t signalID;
+        Double_t energy;
+        /// The signal type, as an index in fStreamSignalTypes
+        Int_t type;
+
+        bool operator<(const StreamDeposit& other) const { return time < other.time; }
+    };
+
+    /// The time ordered stream deposits still needed by pending frames or future triggers
+    std::deque<StreamDeposit> fStreamDeposits;  //!
+
+    /// The trigger times of the frames not returned yet
+    std::deque<Double_t> fStreamTriggers;  //!
+
+    /// The stream time up to which triggers have been searched
+    Double_t fStreamScanTime = 0;  //!
+
+    /// The stream time of the last trigger
+    Double_t fStreamLastTrigger = 0;  //!
+
+    /// The number of input events added to the stream
+    Long64_t fStreamEvents = 0;  //!
+
+    /// The number of entries of the run, the last one flushes the stream (0 if unknown)
+    Long64_t fStreamEndEvent = 0;  //!
+
+    /// The number of frames written
+    Int_t fStreamFrames = 0;  //!
+
+    /// The number of deposits dropped because the stream buffer was full
+    Long64_t fStreamDroppedDeposits = 0;  //!
+
+    /// The number of frames dropped because the pending frames queue or the stream buffer was full
+    Long64_t fStreamDroppedFrames = 0;  //!
+
+    /// The signal types found in the stream, indexed by StreamDeposit::type
+    std::vector<std::string> fStreamSignalTypes;  //!
+
+    /// The detector signals of the stream frame being synthesized
+    TRestDetectorSignalEvent fStreamFrameEvent;  //!
+
     void Initialize() override;
 
     void InitFromConfigFile() override;
@@ -56,6 +115,27 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
     /// The number of time bins the time start is delayed in the resulting output signal.
     Int_t fTriggerDelay = 100;
 
+    /// The maximum number of trigger windows searched in each event
+    Int_t fTriggerWindows = 1;
+
+    /// The shift of the signal IDs of each extra trigger window written to the output event
+    Int_t fTriggerWindowIDOffset = 100000;
+
+    /// If true, the input events are treated as a continuous stream (see streaming mode)
+    Bool_t fStreaming = false;
+
+    /// The stream time between the start of two consecutive input events (0 means the window length)
+    Double_t fStreamEventSpacing = 0;  // us
+
+    /// The minimum time between two stream triggers (0 means the window length)
+    Double_t fStreamDeadTime = 0;  // us
+
+    /// The maximum number of deposits kept in the stream buffer
+    Int_t fStreamBufferSize = 1000000;
+
+    /// The maximum number of triggered frames waiting to be returned
+    Int_t fStreamMaxPendingFrames = 100;
+
     /// The starting time for the "fixed" trigger mode (can be offset by the trigger delay)
     Int_t fTriggerFixedStartTime = 0;
 
@@ -71,6 +151,12 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
     Double_t fIntegralThreshold = 1229.0;
     Double_t fIntegralThresholdTPCkeV = 0.1;
 
+    /// The time step used by the integralThreshold trigger mode to scan the event
+    Double_t fIntegralThresholdStep = 0.5;  // us
+
+    /// The integralThreshold trigger mode keeps the "first" or the "last" time the threshold is crossed
+    std::string fIntegralThresholdCrossing = "last";
+
     /// two distinct energy values used for calibration
     TVector2 fCalibrationEnergy = TVector2(0.0, 0.0);
     /// position in the range corresponding to the energy in 'fCalibrationEnergy'. Values between 0 and 1
@@ -86,6 +172,43 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
     // Noise level
     Double_t fNoiseLevel = 0.0;
 
+    /// The maximum number of threads used to synthesize the signals of an event
+    Int_t fChannelThreads = 1;
+
+    /// A text file with the gain factor and offset shift of individual channels
+    std::string fChannelCalibration;
+
+    /// The gain factor of each channel, indexed by signal (DAQ) ID
+    std::vector<Double_t> fChannelGains;  //!
+
+    /// The offset shift of each channel, in ADC counts, indexed by signal (DAQ) ID
+    std::vector<Double_t> fChannelOffsets;  //!
+
+    /// Seed of the noise generator, combined with the run, event and signal IDs of each noise waveform
+    Int_t fNoiseSeed = 0;
+
+    /// The run number used to define the noise streams, obtained at InitProcess
+    Int_t fRunNumber = 0;  //!
+
+    /// A pedestal run file (TRestRawSignalEvent) or "generate" to replay noise waveforms from a library
+    std::string fNoiseLibrary;
+
+    /// Number of waveforms of the noise library when it is generated by the process
+    Int_t fNoiseLibrarySize = 100;
+
+    /// Baseline subtracted noise waveforms stored contiguously. Shared by all the process instances.
+    std::shared_ptr<const std::vector<Float_t>> fNoiseLibraryWaveforms;  //!
+
+    /// The number of samples of each waveform inside the noise library
+    Int_t fNoiseLibraryLength = 0;  //!
+
+    /// The algorithm used to convolve the binned signal with the shaping function
+    /// ("auto", "direct", "sparse" or "fft")
+    std::string fShapingMethod = "auto";
+
+    /// The tabulated shaping function is truncated after the last bin with an absolute value above this one
+    Double_t fShapingKernelEpsilon = 1.0E-9;
+
    public:
     inline Double_t GetSampling() const { return fSampling; }
 
@@ -99,6 +222,12 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
 
     inline Double_t GetIntegralThreshold() const { return fIntegralThreshold; }
 
+    inline Double_t GetIntegralThresholdStep() const { return fIntegralThresholdStep; }
+
+    inline std::string GetIntegralThresholdCrossing() const { return fIntegralThresholdCrossing; }
+
+    inline std::string GetShapingMethod() const { return fShapingMethod; }
+
     inline bool IsLinearCalibration() const {
         // Will return true if two points have been given for calibration
         return (fCalibrationEnergy.Mod() != 0 && fCalibrationRange.Mod() != 0);
@@ -106,12 +235,32 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
 
     RESTValue GetInputEvent() const override { return fInputSignalEvent; }
 
+    inline const TRestDetectorSignalEvent* GetInputSignalEvent() const { return fInputSignalEvent; }
+
     RESTValue GetOutputEvent() const override { return fOutputRawSignalEvent; }
 
+    inline const std::vector<Double_t>& GetTriggerWindowTimes() const { return fTriggerWindowTimes; }
+
+    inline Int_t GetTriggerWindowIDOffset() const { return fTriggerWindowIDOffset; }
+
+    TRestRawSignalEvent* GetWindowEvent(Int_t window);
+
+    inline Int_t GetStreamFrames() const { return fStreamFrames; }
+
+    inline Int_t GetStreamPendingFrames() const { return fStreamTriggers.size(); }
+
+    inline Long64_t GetStreamDroppedFrames() const { return fStreamDroppedFrames; }
+
+    inline Long64_t GetStreamDroppedDeposits() const { return fStreamDroppedDeposits; }
+
     Double_t GetEnergyFromADC(Double_t adc, const std::string& type = "") const;
 
     Double_t GetADCFromEnergy(Double_t energy, const std::string& type = "") const;
 
+    Double_t GetEnergyFromADCForSignal(Int_t signalID, Double_t adc, const std::string& type = "") const;
+
+    Double_t GetADCFromEnergyForSignal(Int_t signalID, Double_t energy, const std::string& type = "") const;
+
     Double_t GetTimeFromBin(Double_t bin, const std::string& type = "") const;
 
     Double_t GetBinFromTime(Double_t time, const std::string& type = "") const;
@@ -124,10 +273,174 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
         Double_t noiseLevel = 0.0;
         TVector2 calibrationEnergy = {0, 0};
         TVector2 calibrationRange = {0, 0};
+
+        /// The shaping model, "sin" (tabulated sin shaper), "crrc" (recursive CR-RC^n filter) or
+        /// "response" (tabulated measured response)
+        std::string shapingModel = "sin";
+        /// The file with the measured impulse response used by the "response" shaping model
+        std::string shapingResponse;
+        /// The number of integration stages of the "crrc" shaping model
+        Int_t shapingOrder = 4;
+        /// The uncompensated preamplifier decay time of the "crrc" model (0 means no undershoot)
+        Double_t shapingDecayTime = 0.0;
+
+        /// Signals which cannot exceed this amplitude (ADC counts over the offset) are not synthesized
+        Double_t earlyRejectionThreshold = 0.0;
+
+        /// If true, the waveforms of this readout type are synthesized in single precision
+        Bool_t singlePrecision = false;
+
+        /// The emulated zero suppression threshold, in ADC counts over the offset (0 means disabled)
+        Double_t zeroSuppressionThreshold = 0.0;
+        /// The number of samples kept before and after the samples over the zero suppression threshold
+        Int_t zeroSuppressionPreSamples = 0;
+        Int_t zeroSuppressionPostSamples = 0;
+
+        /// The shaping function tabulated at `sampling`, truncated at its last relevant bin
+        std::vector<Double_t> shapingKernel;  //!
+
+        /// Single precision copy of the tabulated shaping function, used when `singlePrecision` is set
+        std::vector<Float_t> shapingKernelFloat;  //!
+
+        /// Fourier transform of the tabulated shaping function, used by the "fft" method
+        std::vector<std::complex<Double_t>> shapingKernelSpectrum;  //!
+
+        /// Absolute maximum of the shaping function, used to bound the pulse amplitudes
+        Double_t shapingKernelMaximum = 1.0;  //!
+
+        inline Bool_t HasShaping() const { return shapingTime > 0 || shapingModel == "response"; }
     };
 
+    const Parameters* GetParametersHandle(const std::string& type = "") const;
+
+    void GetEnergyFromADC(const Parameters& parameters, const Double_t* adc, Double_t* energy,
+                          size_t n) const;
+
+    void GetADCFromEnergy(const Parameters& parameters, const Double_t* energy, Double_t* adc,
+                          size_t n) const;
+
+    void GetEnergyFromADCForSignal(const Parameters& parameters, Int_t signalID, const Double_t* adc,
+                                   Double_t* energy, size_t n) const;
+
+    void GetADCFromEnergyForSignal(const Parameters& parameters, Int_t signalID, const Double_t* energy,
+                                   Double_t* adc, size_t n) const;
+
+    void GetTimeFromBin(const Parameters& parameters, const Double_t* bin, Double_t* time, size_t n) const;
+
+    void GetBinFromTime(const Parameters& parameters, const Double_t* time, Double_t* bin, size_t n) const;
+
+    static Double_t ShapingFunction(Double_t t);
+
+    static std::vector<Double_t> GetShapingKernel(Double_t sampling, Double_t shapingTime, Int_t nPoints,
+                                                  Double_t epsilon = 0);
+
+    static std::vector<Double_t> GetResponseKernel(const TGraph& response, Double_t sampling, Int_t nPoints,
+                                                   Double_t epsilon = 0);
+
+    static std::vector<std::complex<Double_t>> GetShapingKernelSpectrum(const std::vector<Double_t>& kernel,
+                                                                        Int_t nPoints);
+
+    static void ShapeDirect(const Double_t* input, Double_t* output, Int_t nPoints,
+                            const std::vector<Double_t>& kernel);
+    static void ShapeDirect(const Float_t* input, Float_t* output, Int_t nPoints,
+                            const std::vector<Float_t>& kernel);
+
+    static void ShapeSparse(const Double_t* input, const std::vector<Int_t>& occupiedBins, Double_t* output,
+                            Int_t nPoints, const std::vector<Double_t>& kernel);
+    static void ShapeSparse(const Float_t* input, const std::vector<Int_t>& occupiedBins, Float_t* output,
+                            Int_t nPoints, const std::vector<Float_t>& kernel);
+
+    static void ShapeFFT(const Double_t* input, Double_t* output, Int_t nPoints,
+                         const std::vector<std::complex<Double_t>>& kernelSpectrum);
+    static void ShapeFFT(const Float_t* input, Float_t* output, Int_t nPoints,
+                         const std::vector<std::complex<Double_t>>& kernelSpectrum);
+    static void ShapeFFT(const Double_t* input, Double_t* output, Int_t nPoints,
+                         const std::vector<std::complex<Double_t>>& kernelSpectrum,
+                         std::vector<std::complex<Double_t>>& buffer);
+    static void ShapeFFT(const Float_t* input, Float_t* output, Int_t nPoints,
+                         const std::vector<std::complex<Double_t>>& kernelSpectrum,
+                         std::vector<std::complex<Double_t>>& buffer);
+
+    static void ShapeCRRC(const Double_t* input, Double_t* output, Int_t nPoints, Double_t sampling,
+                          Double_t shapingTime, Int_t order, Double_t decayTime = 0);
+    static void ShapeCRRC(const Float_t* input, Float_t* output, Int_t nPoints, Double_t sampling,
+                          Double_t shapingTime, Int_t order, Double_t decayTime = 0);
+
+    static Bool_t QuantizeToADC(const Double_t* input, Short_t* output, Int_t nPoints);
+    static Bool_t QuantizeToADC(const Float_t* input, Short_t* output, Int_t nPoints);
+
+    static Bool_t ZeroSuppress(Short_t* samples, Int_t nPoints, Double_t baseline, Double_t threshold,
+                               Int_t preSamples, Int_t postSamples);
+
+    /// Time ordered deposits of a group of signals, used by the sliding window triggers
+    struct DepositIndex {
+        /// Deposit times in increasing order
+        std::vector<Double_t> times;
+        /// cumulativeEnergy[i] is the energy of the deposits before times[i]. It has one more element.
+        std::vector<Double_t> cumulativeEnergy;
+        /// The (time, energy) pairs sorted to build the index, kept to reuse their memory
+        std::vector<std::pair<Double_t, Double_t>> deposits;
+    };
+
+    static void BuildDepositIndex(const std::vector<const TRestDetectorSignal*>& signals,
+                                  DepositIndex& index);
+
+    static Bool_t FindIntegralThresholdTime(const DepositIndex& deposits, Double_t minTime,
+                                            Double_t maxTime, Double_t sampling, Int_t nPoints, Double_t step,
+                                            Double_t threshold, Bool_t firstCrossing, Double_t& startTime);
+
+    static Bool_t FindIntegralThresholdTPCTime(const DepositIndex& deposits, Double_t minTime,
+                                               Double_t maxTime, Double_t sampling, Int_t nPoints,
+                                               Double_t threshold, Double_t& triggerTime);
+
+    /// Identifies an independent noise stream. Noise waveforms depend only on these values.
+    struct NoiseStream {
+        UInt_t seed = 0;
+        UInt_t runID = 0;
+        UInt_t eventID = 0;
+        UInt_t subEventID = 0;
+        UInt_t signalID = 0;
+        UInt_t stage = 0;
+    };
+
+    static void AddNoise(Double_t* data, Int_t nPoints, Double_t noiseLevel, const NoiseStream& stream);
+    static void AddNoise(Float_t* data, Int_t nPoints, Double_t noiseLevel, const NoiseStream& stream);
+
+    static void AddLibraryNoise(Double_t* data, Int_t nPoints, const std::vector<Float_t>& library,
+                                Int_t waveformLength, const NoiseStream& stream);
+    static void AddLibraryNoise(Float_t* data, Int_t nPoints, const std::vector<Float_t>& library,
+                                Int_t waveformLength, const NoiseStream& stream);
+
+    /// Scratch buffers used to synthesize the raw signals, reused from one signal to the next
+    struct SynthesisBuffers {
+        std::vector<Double_t> data;
+        std::vector<Double_t> deposits;
+        std::vector<Double_t> shaped;
+        /// Used instead of data, deposits and shaped by the single precision synthesis
+        std::vector<Float_t> dataFloat;
+        std::vector<Float_t> depositsFloat;
+        std::vector<Float_t> shapedFloat;
+        std::vector<Int_t> occupiedBins;
+        /// The transform used by the "fft" shaping method
+        std::vector<std::complex<Double_t>> spectrum;
+    };
+
+    Bool_t SynthesizeSignal(const TRestDetectorSignal* signal, const Parameters& parameters,
+                            Double_t startTimeNoOffset, const NoiseStream& noiseStream,
+                            SynthesisBuffers& buffers, Short_t* output) const;
+
+    /// A trigger strategy sets the time of the bin 0 of the acquisition window (before the trigger delay)
+    /// for the current input event, and returns false if the event must be rejected.
+    using TriggerStrategy = std::function<Bool_t(TRestDetectorSignalToRawSignalProcess&, Double_t&)>;
+
+    static void RegisterTriggerStrategy(const std::string& name, const TriggerStrategy& strategy);
+
+    static std::set<std::string> GetTriggerModes();
+
     void InitProcess() override;
 
+    void EndProcess() override;
+
     TRestEvent* ProcessEvent(TRestEvent* inputEvent) override;
 
     void LoadConfig(const std::string& configFilename, const std::string& name = "");
@@ -148,10 +461,106 @@ class TRestDetectorSignalToRawSignalProcess : public TRestEventProcess {
     ~TRestDetectorSignalToRawSignalProcess() override;
 
    private:
+    static std::map<std::string, TriggerStrategy>& GetTriggerStrategies();
+
+    const std::vector<const TRestDetectorSignal*>& GetInputSignals();
+
+    const std::vector<const TRestDetectorSignal*>& GetTPCSignals();
+
+    Bool_t TriggerFirstDeposit(Double_t& startTimeNoOffset);
+    Bool_t TriggerIntegralThreshold(Double_t& startTimeNoOffset);
+    Bool_t TriggerFixed(Double_t& startTimeNoOffset);
+    Bool_t TriggerObservable(Double_t& startTimeNoOffset);
+    Bool_t TriggerFirstDepositTPC(Double_t& startTimeNoOffset);
+    Bool_t TriggerIntegralThresholdTPC(Double_t& startTimeNoOffset);
+
+    /// The trigger strategy corresponding to fTriggerMode, resolved at InitProcess
+    TriggerStrategy fTriggerStrategy;  //!
+
+    /// The input signals used by the trigger strategies, reused from one event to the next
+    std::vector<const TRestDetectorSignal*> fTriggerSignals;  //!
+
+    /// The time ordered deposits used by the trigger strategies, reused from one event to the next
+    DepositIndex fTriggerDeposits;  //!
+
+    /// The scratch buffers used by SynthesizeSignal, one per thread
+    std::vector<SynthesisBuffers> fSynthesisBuffers;  //!
+
+    /// The threads sharing the synthesis of the signals with the process thread. They are started by the
+    /// first event which needs them and kept until EndProcess.
+    struct WorkerPool;
+    WorkerPool* fWorkerPool = nullptr;  //!
+
+    /// The synthesized samples of all the signals of the current event, fNPoints per signal
+    std::vector<Short_t> fEventSamples;  //!
+
+    /// Whether each synthesized signal of the current event has been clipped
+    std::vector<UChar_t> fEventClipped;  //!
+
+    /// The parameters of each signal of the current event
+    std::vector<const Parameters*> fEventParameters;  //!
+
+    /// Whether each signal of the current event is skipped by the early rejection
+    std::vector<UChar_t> fEventSkipped;  //!
+
+    /// The indices of the input signals written to the output event, after the zero suppression
+    std::vector<Int_t> fEventWritten;  //!
+
+    /// The raw signal used to transfer each synthesized signal to an output event with other channels
+    TRestRawSignal fRawSignal;  //!
+
+    TRestEvent* ProcessStreamEvent();
+
+    void FindTriggerWindows(Double_t startTimeNoOffset);
+
+    Int_t FillRawSignalEvent(TRestRawSignalEvent* event, size_t window);
+
+    Double_t GetPulseAmplitudeBound(const TRestDetectorSignal* signal, const Parameters& parameters,
+                                    Double_t startTimeNoOffset) const;
+
+    void SynthesizeSignals(Double_t startTimeNoOffset, const NoiseStream& eventNoiseStream);
+
+    void StopWorkerPool();
+
+    void InitNoiseLibrary();
+
+    std::vector<Double_t> LoadResponseKernel(const Parameters& parameters);
+
+    void InitParametersTable();
+
+    void InitChannelCalibration();
+
+    inline Double_t GetChannelGain(Int_t signalID) const {
+        return signalID >= 0 && signalID < (Int_t)fChannelGains.size() ? fChannelGains[signalID] : 1.0;
+    }
+
+    inline Double_t GetChannelOffset(Int_t signalID) const {
+        return signalID >= 0 && signalID < (Int_t)fChannelOffsets.size() ? fChannelOffsets[signalID] : 0.0;
+    }
+
+    const Parameters& GetSignalParameters(const TRestDetectorSignal* signal);
+
+    template <typename T>
+    void ShapeSignal(const T* deposits, T* output, const Parameters& parameters,
+                     std::vector<Int_t>& occupiedBins, std::vector<std::complex<Double_t>>& spectrum) const;
+
+    template <typename T>
+    Bool_t SynthesizeWaveform(const TRestDetectorSignal* signal, const Parameters& parameters,
+                              Double_t startTimeNoOffset, const NoiseStream& noiseStream,
+                              std::vector<T>& data, std::vector<T>& deposits, std::vector<T>& shaped,
+                              std::vector<Int_t>& occupiedBins, std::vector<std::complex<Double_t>>& spectrum,
+                              Short_t* output) const;
+
     std::map<std::string, Parameters> fParametersMap;
     std::set<std::string> fReadoutTypes;
 
-    ClassDefOverride(TRestDetectorSignalToRawSignalProcess, 8);
+    /// The parameters of each signal, indexed by signal (DAQ) ID. Entries point to fParametersMap values.
+    std::vector<const Parameters*> fParametersBySignalID;  //!
+
+    /// The type of each entry of fParametersBySignalID
+    std::vector<std::string> fTypeBySignalID;  //!
+
+    ClassDefOverride(TRestDetectorSignalToRawSignalProcess, 10);
 };
 
 #endif
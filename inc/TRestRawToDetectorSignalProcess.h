@@ -37,8 +37,38 @@ class TRestRawToDetectorSignalProcess : public TRestEventProcess {
     /// A pointer to the specific TRestDetectorSignalEvent input
     TRestDetectorSignalEvent* fOutputSignalEvent;  //!
 
+    /// The samples of the raw signal being processed
+    std::vector<Short_t> fSamples;  //!
+
+    /// The points over threshold of the raw signal being processed
+    std::vector<Int_t> fPointsOverThreshold;  //!
+
+    /// The pedestal mean of each channel, indexed by signal ID
+    std::vector<Double_t> fPedestalMean;  //!
+
+    /// The pedestal sigma of each channel, indexed by signal ID. Negative for channels without pedestal.
+    std::vector<Double_t> fPedestalSigma;  //!
+
+    /// True if the pulse time is defined by the constant fraction, false for the peak time
+    Bool_t fPulseTimeConstantFraction = false;  //!
+
+    /// True if the pulse value is its integral, false for its amplitude
+    Bool_t fPulseValueIntegral = false;  //!
+
+    /// The number of pulses found in the last event, in pulse mode
+    Int_t fNPulses = 0;  //!
+
+    /// The mean width of the pulses found in the last event, in pulse mode
+    Double_t fMeanPulseWidth = 0;  //!
+
     void Initialize() override;
 
+    void ReadSamples(TRestRawSignal* rawSignal);
+
+    void InitPedestals();
+
+    Int_t AddPulses(TRestDetectorSignal& signal, Double_t baseLine, Double_t& pulseWidth) const;
+
    protected:
     /// The sampling time used to transform the binned data to time information
     Double_t fSampling = 0.1;
@@ -70,6 +100,27 @@ class TRestRawToDetectorSignalProcess : public TRestEventProcess {
     /// Number of consecutive points over threshold required to accept a signal.
     Int_t fNPointsOverThreshold = 5;
 
+    /// A pulse is ended after this number of consecutive points over threshold without a significant change.
+    Int_t fNPointsFlatThreshold = 512;
+
+    /// A pedestal run used to define the baseline and baseline fluctuation of each channel
+    std::string fPedestalRun = "";
+
+    /// Fraction of the pedestal mean difference found in each event used to update the pedestals
+    Double_t fPedestalUpdateFactor = 0;
+
+    /// If true, a single point is produced for each pulse
+    Bool_t fPulseMode = false;
+
+    /// The time of each pulse point ("peak" or "constantFraction")
+    std::string fPulseTime = "peak";
+
+    /// The fraction of the pulse amplitude defining the pulse time in "constantFraction" mode
+    Double_t fConstantFraction = 0.5;
+
+    /// The value of each pulse point ("amplitude" or "integral")
+    std::string fPulseAmplitude = "amplitude";
+
     /// A parameter to determine if baseline correction has been applied by a previous process
     Bool_t fBaseLineCorrection = false;
 
@@ -77,9 +128,34 @@ class TRestRawToDetectorSignalProcess : public TRestEventProcess {
     RESTValue GetInputEvent() const override { return fInputSignalEvent; }
     RESTValue GetOutputEvent() const override { return fOutputSignalEvent; }
 
+    void InitProcess() override;
+
     TRestEvent* ProcessEvent(TRestEvent* inputEvent) override;
 
-    void ZeroSuppresion(TRestRawSignal* rawSignal, TRestDetectorSignal& signal);
+    Double_t ZeroSuppresion(TRestRawSignal* rawSignal, TRestDetectorSignal& signal);
+
+    void FindPointsAboveThreshold(const Short_t* samples, Int_t nPoints, Double_t baseLine,
+                                  std::vector<Int_t>& points) const;
+
+    void CalculateBaseLine(const Short_t* samples, Int_t nPoints, Double_t& baseLine,
+                           Double_t& baseLineSigma) const;
+
+    void FindPointsOverThreshold(const Short_t* samples, Int_t nPoints, Double_t baseLine,
+                                 Double_t baseLineSigma, std::vector<Int_t>& points) const;
+
+    inline Int_t GetNPulses() const { return fNPulses; }
+
+    inline Double_t GetMeanPulseWidth() const { return fMeanPulseWidth; }
+
+    /// It returns the current pedestal mean of the channel `signalID`, 0 if it has no pedestal
+    inline Double_t GetPedestalMean(Int_t signalID) const {
+        return signalID >= 0 && signalID < (Int_t)fPedestalMean.size() ? fPedestalMean[signalID] : 0;
+    }
+
+    /// It returns the pedestal sigma of the channel `signalID`, negative if it has no pedestal
+    inline Double_t GetPedestalSigma(Int_t signalID) const {
+        return signalID >= 0 && signalID < (Int_t)fPedestalSigma.size() ? fPedestalSigma[signalID] : -1;
+    }
 
     /// It prints out the process parameters stored in the metadata structure
     void PrintMetadata() override {
@@ -97,6 +173,18 @@ class TRestRawToDetectorSignalProcess : public TRestEventProcess {
             RESTMetadata << "Point Threshold : " << fPointThreshold << " sigmas" << RESTendl;
             RESTMetadata << "Signal threshold : " << fSignalThreshold << " sigmas" << RESTendl;
             RESTMetadata << "Number of points over threshold : " << fNPointsOverThreshold << RESTendl;
+            RESTMetadata << "Number of flat points over threshold : " << fNPointsFlatThreshold << RESTendl;
+            if (!fPedestalRun.empty()) {
+                RESTMetadata << "Pedestal run : " << fPedestalRun
+                             << " (update factor : " << fPedestalUpdateFactor << ")" << RESTendl;
+            }
+        }
+
+        if (fPulseMode) {
+            RESTMetadata << "Pulse mode : time " << fPulseTime << ", value " << fPulseAmplitude << RESTendl;
+            if (fPulseTime == "constantFraction") {
+                RESTMetadata << "Constant fraction : " << fConstantFraction << RESTendl;
+            }
         }
 
         if (fBaseLineCorrection)
@@ -114,9 +202,11 @@ class TRestRawToDetectorSignalProcess : public TRestEventProcess {
     // Constructor
     TRestRawToDetectorSignalProcess();
 
+    explicit TRestRawToDetectorSignalProcess(const char* configFilename);
+
     // Destructor
     ~TRestRawToDetectorSignalProcess();
 
-    ClassDefOverride(TRestRawToDetectorSignalProcess, 2);
+    ClassDefOverride(TRestRawToDetectorSignalProcess, 3);
 };
 #endif
@@ -73,12 +73,22 @@
 ///     will start to scan the input signal event from the first time
 ///     deposit. The time at which the value of this integral is above
 ///     the value provided at the **integralThreshold** parameter will
-///     be defined as the center of the acquisition window.
+///     be defined as the center of the acquisition window. The window is
+///     moved in steps of **integralThresholdStep** (default 0.5 us), and
+///     **integralThresholdCrossing** defines if the *last* (default) or the
+///     *first* time the threshold is crossed is used.
 ///   - *fixed*: User manually sets the time corresponding to the bin 0 via the **triggerFixedStartTime**
 ///     parameter. It is affected by the **triggerDelay** parameter.
 ///   - *observable*: User manually sets the time corresponding to the bin 0 via the
 ///   **triggerModeObservableName**
 ///   - *firstDepositTPC*: Similar to first deposit but only using TPC signals (channels with type "tpc")
+///   - *integralThresholdTPC*: The trigger time is the first time, scanned in steps of **sampling** from the
+///     first TPC deposit, at which the TPC energy inside the preceding **nPoints** samples reaches the
+///     **integralThresholdTPCkeV** parameter. The TPC deposits are merged in a single time ordered
+///     array and swept with a sliding window, so the cost is linear in the number of deposits.
+///
+///   The trigger mode is resolved once at InitProcess. Additional trigger modes can be made available
+///   by registering a new strategy with TRestDetectorSignalToRawSignalProcess::RegisterTriggerStrategy.
 ///
 /// * **integralThreshold**: It defines the value to be used in the
 ///     triggerThreshold method. This parameter is not used otherwise.
@@ -99,6 +109,41 @@
 /// definition can be shifted using this parameter. The shift is
 /// measured in number of bins from the output signal.
 ///
+/// * **triggerWindows**: The maximum number of trigger windows searched in each event. Default is 1.
+/// If larger, deposits delayed beyond the end of the window defined by the trigger mode (decay chains,
+/// pileup) trigger new windows: each new window is triggered by the first deposit after the end of the
+/// previous one, applying the trigger delay. All the windows are found with a single sweep over the
+/// time ordered deposits. The number of windows found is stored in the *nTriggerWindows* observable.
+/// Since a process returns one output event per input event, all the windows are written to the
+/// output event, which has SubID 0: the signals of the window number k have their signal ID shifted
+/// by k times **triggerWindowIDOffset** (default 100000), and the start times of the windows are
+/// returned by GetTriggerWindowTimes(). Each window is also available as a separate event with
+/// GetWindowEvent(window), which sets the window index as SubID and keeps the signal IDs.
+///
+/// * **streaming**: If true, the input events are treated as consecutive parts of a continuous time
+/// stream (triggerless continuous readout), and the trigger mode is ignored. The deposits of the input
+/// event number i (counted by the process) are placed at i * **streamEventSpacing** (default is the
+/// acquisition window length, fNPoints times the sampling) and added to a buffer of pending deposits,
+/// kept in time order. Triggers are searched with a sliding window, as in the integralThreshold trigger
+/// mode: a trigger is issued at the start time of a window of half the acquisition length when the
+/// integral of its deposits is above **integralThreshold**, and no new trigger is accepted during
+/// **streamDeadTime** (default is the window length, a shorter dead time gives overlapping frames). The
+/// frame of a trigger starts triggerDelay samples before it, using the largest sampling of the readout
+/// types, and it is written as soon as no later input event can add deposits to it. All the frames
+/// completed by an input event are written to its output event (nullptr if none is complete): the first
+/// one has the frame number as SubID, and the signals of the next ones have their signal ID shifted by
+/// multiples of triggerWindowIDOffset, as for triggerWindows. When the process knows the number of
+/// entries of the run, the last entry flushes all the pending frames. **streamMaxPendingFrames**
+/// (default 100) bounds the number of frames waiting for the next events, dropping the newest ones, as
+/// by a busy DAQ. Deposits are removed from the buffer when no pending frame or future trigger needs
+/// them, and **streamBufferSize** (default 1000000) bounds the number of buffered deposits, dropping the
+/// oldest ones. The deposits of a pending frame are never dropped: if they are the oldest ones, the
+/// whole frame is dropped instead. The stream of each process instance is independent, so this mode is
+/// meant to be used with a single thread. The observables *streamFrameTime* (trigger time of the first
+/// frame of the output event in the stream), *streamFrames* (number of frames in the output event),
+/// *streamPendingFrames*, *streamDroppedFrames* and *streamDroppedDeposits* can be used to monitor the
+/// stream.
+///
 /// * **gain**: Each data point from the resulting raw signal will be
 /// multiplied by this factor before performing the conversion to
 /// Short_t. Each value in the raw output signal should be between
@@ -113,11 +158,104 @@
 /// 0.0 corresponds to the minimum of the signal range (-32768 for Short_t) and 1.0 to the maximum (32767 for
 /// Short_t)
 ///
-/// * **shapingTime**: shaping time in time units. If set the signal will be shaped by sin + undershoot
-/// shaper. We allow shaping in this process to avoid artifacts produced if shaping the signal after
-/// digitalization.
+/// * **shapingTime**: shaping time in time units. If set the signal will be shaped using the model
+/// defined by *shapingModel*. We allow shaping in this process to avoid artifacts produced if shaping
+/// the signal after digitalization.
 /// TODO: Rework TRestRawSignal so this is not needed and remove shaping from this process
 ///
+/// * **shapingMethod**: The algorithm used to convolve the binned signal with the shaping function.
+///   - *auto*: (default) The method is chosen for each signal from the number of occupied bins and the
+///     length of the tabulated shaping function, picking the one with the lowest estimated cost.
+///   - *direct*: Every bin of the signal is checked, and each positive one is convolved with the
+///     tabulated shaping function, O(nPoints x kernel length).
+///   - *sparse*: Only the list of occupied (positive) bins is convolved, writing only the output bins
+///     inside the shaping function support, O(occupied bins x kernel length).
+///   - *fft*: The binned signal is transformed once, multiplied by the cached transform of the
+///     shaping function and transformed back, O(nPoints log(nPoints)). The result agrees with the
+///     *direct* and *sparse* methods within double precision round-off (below 1e-9 of the pulse
+///     amplitude), far below one ADC count, so the raw signals only differ when a sample lies on a
+///     rounding boundary.
+///
+/// * **noiseLevel**: Standard deviation, in ADC units, of the gaussian noise added to each sample
+/// before and after shaping.
+///
+/// * **zeroSuppressionThreshold**: If set (> 0), the zero suppression of the front-end electronics
+/// (e.g. FEMINOS/AGET) is emulated for each readout type (*zeroSuppressionThreshold* + readout type
+/// name). Only the samples more than this number of ADC counts above the offset, together with
+/// **zeroSuppressionPreSamples** samples before and **zeroSuppressionPostSamples** samples after them
+/// (default 0), are kept, and the other samples are set to 0. Signals without samples above the
+/// threshold are not written, and events (or stream frames) whose signals are all suppressed are
+/// rejected. The number of suppressed signals is stored in the *zeroSuppressedSignals* observable.
+///
+/// * **singlePrecision**: If true, the waveforms of each readout type (*singlePrecision* + readout type
+/// name) are binned, shaped and perturbed with noise in single precision before being converted to
+/// ADC counts. It halves the memory traffic of the synthesis and doubles the number of samples
+/// processed per SIMD instruction. The result differs from the double precision synthesis by at most
+/// one ADC count in a few samples. The *fft* shaping method and the *crrc* filter state are kept in
+/// double precision. Default is false.
+///
+/// * **earlyRejectionThreshold**: If set (> 0), the signals of each readout type
+/// (*earlyRejectionThreshold* + readout type name) which cannot produce a pulse higher than this number
+/// of ADC counts over the offset are skipped before their synthesis. The pulse amplitude is bounded by
+/// the energy deposited inside the acquisition window times the gain and the maximum of the shaping
+/// function, ignoring noise. Events whose signals are all skipped are rejected. The number of skipped
+/// signals is stored in the *earlyRejectedSignals* observable.
+///
+/// * **channelCalibration**: A text file with the calibration of individual channels, to emulate the
+/// gain non-uniformity of a real detector. Each line contains a signal (DAQ) ID, a gain factor which
+/// multiplies the readout type gain, and optionally an offset shift (in ADC counts) added to the
+/// readout type offset. Lines starting with '#' are ignored. The channels which are not listed keep
+/// the readout type calibration. The table is stored indexed by signal ID, so it has no lookup cost.
+/// GetEnergyFromADCForSignal and GetADCFromEnergyForSignal include the channel calibration, while
+/// GetEnergyFromADC and GetADCFromEnergy only use the readout type calibration.
+///
+/// * **channelThreads**: The maximum number of threads used to synthesize the signals of a single
+/// event. Default is 1 (no additional threads). It helps for large events (e.g. a muon track over a
+/// whole readout plane) which are not sped up by the event level threads of TRestProcessRunner.
+/// Threads are only started for events with at least 32 signals per thread, and the output does not
+/// depend on the number of threads.
+///
+/// * **noiseSeed**: Noise is produced by a counter-based generator (Philox4x32-10), so that the noise
+/// waveform of a signal only depends on this seed and on the run, event, sub-event and signal IDs. The
+/// result is reproducible independently of the number of threads or the event processing order.
+///
+/// * **noiseLibrary**: If defined, the gaussian noise is replaced by noise waveforms taken from a
+/// library, which keeps the correlations between consecutive samples of the real electronics. It can
+/// be the name of a pedestal run file containing TRestRawSignalEvents, whose signals are stored
+/// (baseline subtracted) as library waveforms, or *generate*, in which case **noiseLibrarySize**
+/// waveforms are produced once at initialization using the default noise level and shaping time.
+/// Each signal of a readout type with a positive noise level then gets one randomly selected library
+/// waveform, starting at a random offset, added to its samples after shaping (the readout types with
+/// a null noise level stay noiseless). The selection uses the same counter-based generator as the
+/// gaussian noise. The library is loaded or generated once and shared by all the process instances
+/// with the same configuration.
+///
+/// * **shapingModel**: The shaping model of each readout type (*shapingModel* + readout type name).
+///   - *sin*: (default) The sin shaper, tabulated and convolved with the method set by *shapingMethod*.
+///     The shaping function maximum is reached at 1.166 times the shaping time.
+///   - *response*: A measured impulse response, read from the file defined by *shapingResponse*.
+///   - *crrc*: A CR-RC^n shaper, (t / tau)^n exp(-t / tau) normalized to a maximum of 1.0, reached at
+///     the shaping time (tau = shapingTime / n). It is computed as a cascade of first order recursive
+///     filters which samples the analog response exactly, in O(nPoints x n) whatever the shaping time.
+///
+/// * **shapingResponse**: The file with the measured impulse response of the electronics
+/// (*shapingResponse* + readout type name). If defined, the *response* shaping model is used and the
+/// shaping time is ignored. It can be a ROOT file containing a TGraph or a text file with two columns,
+/// the time elapsed since the deposit (in us) and the amplitude. The response is resampled once at
+/// initialization to the readout type sampling by linear interpolation, normalized to a maximum of
+/// 1.0, and then used as the tabulated sin shaper (see *shapingMethod*).
+///
+/// * **shapingOrder**: The number of integration stages (n) of the *crrc* shaping model, between 1
+/// and 10. Default is 4.
+///
+/// * **shapingDecayTime**: The decay time of the preamplifier signal not compensated by the pole-zero
+/// cancellation of the *crrc* shaping model. If set, the pulse is followed by an undershoot so that its
+/// total area is zero. Default is 0 (perfect pole-zero cancellation, no undershoot).
+///
+/// * **shapingKernelEpsilon**: The shaping function is tabulated once per readout type at
+/// initialization. The table is truncated after the last bin whose absolute value is above this
+/// value (the shaping function maximum is 1.0). Default is 1E-9.
+///
 ///--------------------------------------------------------------------------
 ///
 /// RESTsoft - Software for Rare Event Searches with TPCs
@@ -135,15 +273,732 @@
 
 #include "TRestDetectorSignalToRawSignalProcess.h"
 
+#include <TFile.h>
+#include <TKey.h>
 #include <TObjString.h>
 #include <TRestRawReadoutMetadata.h>
+#include <TRestRun.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
 #include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
 
 using namespace std;
 
 ClassImp(TRestDetectorSignalToRawSignalProcess);
 
+namespace {
+Double_t SinShaper(Double_t t) {
+    if (t <= 0) {
+        return 0;
+    }
+    // function is normalized such that its absolute maximum is 1.0
+    // max is at x = 1.1664004483744728
+    return TMath::Exp(-3.0 * t) * TMath::Power(t, 3.0) * TMath::Sin(t) * 22.68112123672292;
+}
+
+/// Twiddle factors exp(-2 pi i k / n) for k < n / 2, tabulated once per transform size and shared by all
+/// the threads. The sizes used by the synthesis are tabulated at InitProcess with the kernel spectra.
+/// The tables are published by the base 2 logarithm of the size, so that the transforms of the events
+/// only read them, without taking the mutex.
+mutex fftTwiddlesMutex;
+map<size_t, vector<complex<Double_t>>> fftTwiddlesCache;
+array<atomic<const vector<complex<Double_t>>*>, 64> fftTwiddlesTables;
+
+const vector<complex<Double_t>>& GetFFTTwiddles(size_t n) {
+    size_t order = 0;
+    while (((size_t)1 << order) < n) {
+        order++;
+    }
+    const vector<complex<Double_t>>* table = fftTwiddlesTables[order].load(memory_order_acquire);
+    if (table != nullptr) {
+        return *table;
+    }
+
+    lock_guard<mutex> lock(fftTwiddlesMutex);
+    auto& twiddles = fftTwiddlesCache[n];
+    if (twiddles.empty()) {
+        twiddles.resize(n / 2);
+        for (size_t k = 0; k < n / 2; k++) {
+            twiddles[k] = polar(1.0, -2.0 * TMath::Pi() * k / n);
+        }
+        fftTwiddlesTables[order].store(&twiddles, memory_order_release);
+    }
+    return twiddles;
+}
+
+/// In-place iterative radix-2 transform. The size of `data` must be a power of two.
+/// The inverse transform includes the 1/n normalization.
+void TransformFFT(vector<complex<Double_t>>& data, bool inverse) {
+    const size_t n = data.size();
+    const auto& twiddles = GetFFTTwiddles(n);
+
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            swap(data[i], data[j]);
+        }
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1) {
+        const size_t half = length >> 1;
+        const size_t stride = n / length;
+        for (size_t i = 0; i < n; i += length) {
+            for (size_t k = 0; k < half; k++) {
+                const complex<Double_t> w = inverse ? conj(twiddles[k * stride]) : twiddles[k * stride];
+                const complex<Double_t> u = data[i + k];
+                const complex<Double_t> v = data[i + k + half] * w;
+                data[i + k] = u + v;
+                data[i + k + half] = u - v;
+            }
+        }
+    }
+
+    if (inverse) {
+        const Double_t norm = 1.0 / n;
+        for (auto& value : data) {
+            value *= norm;
+        }
+    }
+}
+
+/// One Philox4x32-10 evaluation: four 32 bit random words from a 128 bit counter and a 64 bit key
+void Philox4x32(UInt_t counter[4], UInt_t key0, UInt_t key1) {
+    constexpr ULong64_t multiplier0 = 0xD2511F53;
+    constexpr ULong64_t multiplier1 = 0xCD9E8D57;
+    for (int round = 0; round < 10; round++) {
+        const ULong64_t product0 = multiplier0 * counter[0];
+        const ULong64_t product1 = multiplier1 * counter[2];
+        const UInt_t c0 = (UInt_t)(product1 >> 32) ^ counter[1] ^ key0;
+        const UInt_t c1 = (UInt_t)product1;
+        const UInt_t c2 = (UInt_t)(product0 >> 32) ^ counter[3] ^ key1;
+        const UInt_t c3 = (UInt_t)product0;
+        counter[0] = c0;
+        counter[1] = c1;
+        counter[2] = c2;
+        counter[3] = c3;
+        key0 += 0x9E3779B9;
+        key1 += 0xBB67AE85;
+    }
+}
+
+/// Number of low bits of the second key word which identify the noise stage, above them the sub-event ID
+constexpr UInt_t noiseStageBits = 3;
+
+/// The second key word of the noise generator, unique for each sub-event and stage (below 8)
+UInt_t GetNoiseKey(const TRestDetectorSignalToRawSignalProcess::NoiseStream& stream) {
+    return (stream.subEventID << noiseStageBits) | stream.stage;
+}
+
+/// Noise libraries already loaded from a file or generated, shared by all the process instances
+mutex noiseLibraryMutex;
+map<string, pair<shared_ptr<const vector<Float_t>>, Int_t>> noiseLibraryCache;
+
+/// Removes the trailing bins of a tabulated shaping function whose absolute value is below epsilon
+void TruncateKernel(vector<Double_t>& kernel, Double_t epsilon) {
+    size_t size = kernel.size();
+    while (size > 0 && abs(kernel[size - 1]) <= epsilon) {
+        size--;
+    }
+    kernel.resize(size);
+}
+
+/// Measured responses resampled at init, by file name, sampling, number of points and epsilon
+mutex responseKernelMutex;
+map<tuple<string, Double_t, Int_t, Double_t>, vector<Double_t>> responseKernelCache;
+
+/// Maximum number of integration stages of the CR-RC^n shaper
+constexpr Int_t maxShapingOrder = 10;
+
+/// Protects the registry of trigger strategies
+mutex triggerStrategiesMutex;
+
+/// Names of observables set at every event which do not fit in the small string buffer, built once so
+/// that setting them does not allocate memory
+const string zeroSuppressedSignalsObservable = "zeroSuppressedSignals";
+const string earlyRejectedSignalsObservable = "earlyRejectedSignals";
+
+/// It returns the time reached by repeating `time += step` while the result is not above `target`, with
+/// the same rounding as the repeated sum. Inside a binade every rounded increment is the same once two
+/// consecutive increments are equal, so the steps up to the end of the binade are applied at once.
+Double_t AdvanceScanTime(Double_t time, Double_t step, Double_t target) {
+    Double_t previous = time;
+    Double_t increment = 0;
+    while (time + step <= target) {
+        const Double_t next = time + step;
+        if (next - time == increment && previous != 0 && (previous > 0) == (time > 0) &&
+            ilogb(previous) == ilogb(time)) {
+            // last value from which a step keeps the spacing of the representable numbers unchanged
+            const int exponent = ilogb(time);
+            const Double_t ulp = ldexp(1.0, exponent - 52);
+            const Double_t end =
+                min(target, time > 0 ? ldexp(1.0, exponent + 1) - ulp : -ldexp(1.0, exponent) - ulp);
+            if (next <= end) {
+                auto steps = (Long64_t)((end - next) / increment);
+                while (steps > 0 && next + steps * increment > end) {
+                    steps--;
+                }
+                while (next + (steps + 1) * increment <= end) {
+                    steps++;
+                }
+                previous = steps > 0 ? next + (steps - 1) * increment : time;
+                time = next + steps * increment;
+                continue;
+            }
+        }
+        increment = next - time;
+        previous = time;
+        time = next;
+    }
+    return time;
+}
+
+/// Smallest power of two allowing a linear (non circular) convolution of two nPoints long arrays
+size_t GetFFTSize(Int_t nPoints) {
+    size_t size = 1;
+    while (size < 2 * (size_t)nPoints) {
+        size <<= 1;
+    }
+    return size;
+}
+template <typename T>
+void ShapeDirectKernel(const T* input, T* output, Int_t nPoints, const vector<T>& kernel) {
+    fill(output, output + nPoints, 0.0);
+    const int kernelSize = kernel.size();
+    for (int i = 0; i < nPoints; i++) {
+        const T value = input[i];
+        if (value <= 0) {
+            // Only positive values are possible, 0 means no signal in this bin
+            continue;
+        }
+        const int end = min(nPoints, i + kernelSize);
+        for (int j = i; j < end; j++) {
+            output[j] += value * kernel[j - i];
+        }
+    }
+}
+
+template <typename T>
+void ShapeSparseKernel(const T* input, const vector<Int_t>& occupiedBins, T* output, Int_t nPoints,
+                       const vector<T>& kernel) {
+    fill(output, output + nPoints, 0.0);
+    const int kernelSize = kernel.size();
+    for (const auto i : occupiedBins) {
+        const T value = input[i];
+        const int end = min(nPoints, i + kernelSize);
+        for (int j = i; j < end; j++) {
+            output[j] += value * kernel[j - i];
+        }
+    }
+}
+
+template <typename T>
+void ShapeFFTKernel(const T* input, T* output, Int_t nPoints, const vector<complex<Double_t>>& kernelSpectrum,
+                    vector<complex<Double_t>>& buffer) {
+    buffer.assign(kernelSpectrum.size(), 0.0);
+    for (int i = 0; i < nPoints; i++) {
+        buffer[i] = input[i] > 0 ? input[i] : 0.0;
+    }
+
+    TransformFFT(buffer, false);
+    for (size_t k = 0; k < buffer.size(); k++) {
+        buffer[k] *= kernelSpectrum[k];
+    }
+    TransformFFT(buffer, true);
+
+    for (int j = 0; j < nPoints; j++) {
+        output[j] = buffer[j].real();
+    }
+}
+
+// The filter state is always kept in double precision, since the recursion is sequential anyway and
+// the poles get very close to 1 for long shaping times
+template <typename T>
+void ShapeCRRCKernel(const T* input, T* output, Int_t nPoints, Double_t sampling, Double_t shapingTime,
+                     Int_t order, Double_t decayTime) {
+    const Double_t x = sampling * order / shapingTime;
+    const Double_t a = exp(-x);
+    // (x k)^n exp(-x k) is normalized by its maximum n^n exp(-n)
+    const Double_t normalization = pow(x * TMath::E() / order, order);
+
+    Double_t eulerian[maxShapingOrder] = {1.0};
+    for (int n = 2; n <= order; n++) {
+        for (int m = n - 1; m >= 0; m--) {
+            eulerian[m] = (n - m) * (m > 0 ? eulerian[m - 1] : 0.0) + (m + 1) * eulerian[m];
+        }
+    }
+    Double_t numerator[maxShapingOrder];
+    Double_t power = a;
+    for (int m = 0; m < order; m++) {
+        numerator[m] = normalization * eulerian[m] * power;
+        power *= a;
+    }
+
+    const Double_t decay = decayTime > 0 ? exp(-sampling / decayTime) : 0.0;
+    Double_t poles[maxShapingOrder + 1] = {};
+    Double_t lowPass = 0;
+    for (int k = 0; k < nPoints; k++) {
+        Double_t value = 0;
+        for (int m = 0; m < order && m < k; m++) {
+            const Double_t deposit = input[k - 1 - m];
+            // Only positive values are possible, 0 means no signal in this bin
+            value += deposit > 0 ? numerator[m] * deposit : 0.0;
+        }
+        for (int j = 0; j <= order; j++) {
+            poles[j] = a * poles[j] + value;
+            value = poles[j];
+        }
+        if (decayTime > 0) {
+            lowPass = decay * lowPass + (1 - decay) * value;
+            value -= lowPass;
+        }
+        output[k] = value;
+    }
+}
+
+template <typename T>
+Bool_t QuantizeToADCKernel(const T* input, Short_t* output, Int_t nPoints) {
+    constexpr T minimum = numeric_limits<Short_t>::min();
+    constexpr T maximum = numeric_limits<Short_t>::max();
+    // largest value below 0.5, so that truncating value + half gives the same result as round(value)
+    constexpr T half = T(0.5) - numeric_limits<T>::epsilon() / 4;
+
+    Int_t clipped = 0;
+    for (int i = 0; i < nPoints; i++) {
+        const T value = input[i];
+        clipped |= (value <= minimum - T(0.5)) | (value >= maximum + T(0.5));
+        output[i] = (Short_t)min(max(value + copysign(half, value), minimum), maximum);
+    }
+
+    return clipped != 0;
+}
+
+template <typename T>
+void AddNoiseKernel(T* data, Int_t nPoints, Double_t noiseLevel,
+                    const TRestDetectorSignalToRawSignalProcess::NoiseStream& stream) {
+    constexpr int blockSize = 64;
+    constexpr Double_t toUniform = 1.0 / 4294967296.0;
+
+    const UInt_t key0 = stream.seed;
+    const UInt_t key1 = GetNoiseKey(stream);
+
+    T uniform[blockSize];
+    for (int blockStart = 0; blockStart < nPoints; blockStart += blockSize) {
+        for (int i = 0; i < blockSize; i += 4) {
+            UInt_t counter[4] = {(UInt_t)(blockStart + i) / 4, stream.signalID, stream.eventID, stream.runID};
+            Philox4x32(counter, key0, key1);
+            for (int k = 0; k < 4; k++) {
+                // uniform in (0, 1], never 0 so that the logarithm is defined
+                uniform[i + k] = (counter[k] + 0.5) * toUniform;
+            }
+        }
+
+        const int blockEnd = min(nPoints, blockStart + blockSize);
+        for (int i = blockStart; i < blockEnd; i += 2) {
+            const T radius = T(noiseLevel) * sqrt(T(-2.0) * log(uniform[i - blockStart]));
+            const T angle = T(2.0 * TMath::Pi()) * uniform[i - blockStart + 1];
+            data[i] += radius * cos(angle);
+            if (i + 1 < blockEnd) {
+                data[i + 1] += radius * sin(angle);
+            }
+        }
+    }
+}
+
+template <typename T>
+void AddLibraryNoiseKernel(T* data, Int_t nPoints, const vector<Float_t>& library, Int_t waveformLength,
+                           const TRestDetectorSignalToRawSignalProcess::NoiseStream& stream) {
+    const int nWaveforms = library.size() / waveformLength;
+    if (nWaveforms == 0) {
+        return;
+    }
+
+    UInt_t counter[4] = {0, stream.signalID, stream.eventID, stream.runID};
+    Philox4x32(counter, stream.seed, GetNoiseKey(stream));
+
+    const Float_t* waveform = library.data() + (size_t)(counter[0] % nWaveforms) * waveformLength;
+    int offset = counter[1] % waveformLength;
+    for (int i = 0; i < nPoints;) {
+        const int length = min(nPoints - i, waveformLength - offset);
+        for (int j = 0; j < length; j++) {
+            data[i + j] += waveform[offset + j];
+        }
+        i += length;
+        offset = 0;
+    }
+}
+
+const vector<Double_t>& GetKernel(const TRestDetectorSignalToRawSignalProcess::Parameters& parameters,
+                                  Double_t*) {
+    return parameters.shapingKernel;
+}
+
+const vector<Float_t>& GetKernel(const TRestDetectorSignalToRawSignalProcess::Parameters& parameters,
+                                 Float_t*) {
+    return parameters.shapingKernelFloat;
+}
+}  // namespace
+
+///////////////////////////////////////////////
+/// \brief The shaping function (impulse response) applied to the binned signal, as a function of
+/// the time elapsed since the deposit in units of the shaping time. Its absolute maximum is 1.0.
+///
+Double_t TRestDetectorSignalToRawSignalProcess::ShapingFunction(Double_t t) {
+    if (t <= 0) {
+        return 0;
+    }
+    // return SinShaper(t) - 1.0 * SinShaper(t - 1); // to add undershoot
+    return SinShaper(t);
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the shaping function tabulated at `sampling` for an nPoints long signal. The
+/// table is truncated after the last bin with an absolute value above `epsilon`.
+///
+vector<Double_t> TRestDetectorSignalToRawSignalProcess::GetShapingKernel(Double_t sampling,
+                                                                         Double_t shapingTime,
+                                                                         Int_t nPoints, Double_t epsilon) {
+    vector<Double_t> kernel(nPoints);
+    for (int i = 0; i < nPoints; i++) {
+        kernel[i] = ShapingFunction((i * sampling) / shapingTime);
+    }
+    TruncateKernel(kernel, epsilon);
+
+    return kernel;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns a measured impulse response, given as a function of the time elapsed since the
+/// deposit (in us), resampled at `sampling` for an nPoints long signal by linear interpolation. The
+/// table is normalized to an absolute maximum of 1.0, and truncated after the last bin with an absolute
+/// value above `epsilon`. The response is 0 outside the range of the graph.
+///
+vector<Double_t> TRestDetectorSignalToRawSignalProcess::GetResponseKernel(const TGraph& response,
+                                                                          Double_t sampling, Int_t nPoints,
+                                                                          Double_t epsilon) {
+    vector<Double_t> kernel(nPoints, 0.0);
+    const Int_t n = response.GetN();
+    if (n == 0) {
+        return {};
+    }
+
+    vector<pair<Double_t, Double_t>> points(n);
+    for (int i = 0; i < n; i++) {
+        points[i] = {response.GetX()[i], response.GetY()[i]};
+    }
+    sort(points.begin(), points.end());
+
+    Double_t maximum = 0;
+    int p = 0;
+    for (int i = 0; i < nPoints; i++) {
+        const Double_t t = i * sampling;
+        if (t < points.front().first || t > points.back().first) {
+            continue;
+        }
+        while (p + 1 < n && points[p + 1].first < t) {
+            p++;
+        }
+        if (p + 1 == n || points[p + 1].first == points[p].first) {
+            kernel[i] = points[p].second;
+        } else {
+            const Double_t fraction = (t - points[p].first) / (points[p + 1].first - points[p].first);
+            kernel[i] = points[p].second + fraction * (points[p + 1].second - points[p].second);
+        }
+        maximum = max(maximum, abs(kernel[i]));
+    }
+
+    if (maximum == 0) {
+        return {};
+    }
+    for (auto& value : kernel) {
+        value /= maximum;
+    }
+    TruncateKernel(kernel, epsilon);
+
+    return kernel;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the Fourier transform of the tabulated shaping function, zero padded so that it
+/// can be used by ShapeFFT to convolve nPoints long signals.
+///
+vector<complex<Double_t>> TRestDetectorSignalToRawSignalProcess::GetShapingKernelSpectrum(
+    const vector<Double_t>& kernel, Int_t nPoints) {
+    vector<complex<Double_t>> spectrum(GetFFTSize(nPoints), 0.0);
+    for (int i = 0; i < nPoints && i < (int)kernel.size(); i++) {
+        spectrum[i] = kernel[i];
+    }
+    TransformFFT(spectrum, false);
+    return spectrum;
+}
+
+///////////////////////////////////////////////
+/// \brief It convolves the baseline subtracted binned signal `input` with the tabulated shaping
+/// function. Only positive bins are considered as deposits, and only the output bins inside the
+/// kernel support are updated.
+///
+void TRestDetectorSignalToRawSignalProcess::ShapeDirect(const Double_t* input, Double_t* output,
+                                                        Int_t nPoints, const vector<Double_t>& kernel) {
+    ShapeDirectKernel(input, output, nPoints, kernel);
+}
+
+void TRestDetectorSignalToRawSignalProcess::ShapeDirect(const Float_t* input, Float_t* output, Int_t nPoints,
+                                                        const vector<Float_t>& kernel) {
+    ShapeDirectKernel(input, output, nPoints, kernel);
+}
+
+///////////////////////////////////////////////
+/// \brief Same as ShapeDirect, but only the bins listed in `occupiedBins` are used as deposits. The
+/// list must contain all the positive bins of `input`.
+///
+void TRestDetectorSignalToRawSignalProcess::ShapeSparse(const Double_t* input,
+                                                        const vector<Int_t>& occupiedBins, Double_t* output,
+                                                        Int_t nPoints, const vector<Double_t>& kernel) {
+    ShapeSparseKernel(input, occupiedBins, output, nPoints, kernel);
+}
+
+void TRestDetectorSignalToRawSignalProcess::ShapeSparse(const Float_t* input,
+                                                        const vector<Int_t>& occupiedBins, Float_t* output,
+                                                        Int_t nPoints, const vector<Float_t>& kernel) {
+    ShapeSparseKernel(input, occupiedBins, output, nPoints, kernel);
+}
+
+///////////////////////////////////////////////
+/// \brief It convolves the baseline subtracted binned signal `input` with the shaping function using
+/// the kernel spectrum obtained from GetShapingKernelSpectrum. Only positive bins are considered as
+/// deposits, so that the result matches ShapeDirect within round-off. The transform is computed in
+/// `buffer`, which is reused from one call to the next.
+///
+void TRestDetectorSignalToRawSignalProcess::ShapeFFT(const Double_t* input, Double_t* output, Int_t nPoints,
+                                                     const vector<complex<Double_t>>& kernelSpectrum,
+                                                     vector<complex<Double_t>>& buffer) {
+    ShapeFFTKernel(input, output, nPoints, kernelSpectrum, buffer);
+}
+
+void TRestDetectorSignalToRawSignalProcess::ShapeFFT(const Float_t* input, Float_t* output, Int_t nPoints,
+                                                     const vector<complex<Double_t>>& kernelSpectrum,
+                                                     vector<complex<Double_t>>& buffer) {
+    ShapeFFTKernel(input, output, nPoints, kernelSpectrum, buffer);
+}
+
+void TRestDetectorSignalToRawSignalProcess::ShapeFFT(const Double_t* input, Double_t* output, Int_t nPoints,
+                                                     const vector<complex<Double_t>>& kernelSpectrum) {
+    vector<complex<Double_t>> buffer;
+    ShapeFFTKernel(input, output, nPoints, kernelSpectrum, buffer);
+}
+
+void TRestDetectorSignalToRawSignalProcess::ShapeFFT(const Float_t* input, Float_t* output, Int_t nPoints,
+                                                     const vector<complex<Double_t>>& kernelSpectrum) {
+    vector<complex<Double_t>> buffer;
+    ShapeFFTKernel(input, output, nPoints, kernelSpectrum, buffer);
+}
+
+///////////////////////////////////////////////
+/// \brief It shapes the baseline subtracted binned signal `input` with a CR-RC^n shaper of `order`
+/// integration stages, whose response peaks at `shapingTime` with amplitude 1.0. Only positive bins
+/// are considered as deposits. The sampled response k^n a^k (a = exp(-sampling / tau)) is obtained
+/// exactly from n + 1 cascaded one-pole filters preceded by a n-tap filter whose coefficients are the
+/// Eulerian numbers A(n, m) a^(m + 1). If `decayTime` is positive the preamplifier decay is not
+/// compensated, and the response low-passed with this time constant is subtracted (undershoot).
+///
+void TRestDetectorSignalToRawSignalProcess::ShapeCRRC(const Double_t* input, Double_t* output, Int_t nPoints,
+                                                      Double_t sampling, Double_t shapingTime, Int_t order,
+                                                      Double_t decayTime) {
+    ShapeCRRCKernel(input, output, nPoints, sampling, shapingTime, order, decayTime);
+}
+
+void TRestDetectorSignalToRawSignalProcess::ShapeCRRC(const Float_t* input, Float_t* output, Int_t nPoints,
+                                                      Double_t sampling, Double_t shapingTime, Int_t order,
+                                                      Double_t decayTime) {
+    ShapeCRRCKernel(input, output, nPoints, sampling, shapingTime, order, decayTime);
+}
+
+///////////////////////////////////////////////
+/// \brief It converts `input` to ADC counts, rounding each sample to the nearest integer (halfway
+/// values away from zero) and saturating it to the Short_t range. It returns true if any sample was
+/// saturated. The loop has no branches, so that the compiler can vectorize it.
+///
+Bool_t TRestDetectorSignalToRawSignalProcess::QuantizeToADC(const Double_t* input, Short_t* output,
+                                                            Int_t nPoints) {
+    return QuantizeToADCKernel(input, output, nPoints);
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::QuantizeToADC(const Float_t* input, Short_t* output,
+                                                            Int_t nPoints) {
+    return QuantizeToADCKernel(input, output, nPoints);
+}
+
+///////////////////////////////////////////////
+/// \brief It emulates the zero suppression of the front-end electronics on the ADC `samples`. The
+/// samples more than `threshold` above `baseline` are kept together with `preSamples` samples before
+/// and `postSamples` samples after them, and the other samples are set to 0. It returns false if no
+/// sample is above the threshold, in which case the signal should be dropped.
+///
+Bool_t TRestDetectorSignalToRawSignalProcess::ZeroSuppress(Short_t* samples, Int_t nPoints, Double_t baseline,
+                                                           Double_t threshold, Int_t preSamples,
+                                                           Int_t postSamples) {
+    // the samples before keptEnd have already been kept or set to 0
+    Int_t keptEnd = 0;
+    for (int i = 0; i < nPoints; i++) {
+        if (samples[i] - baseline <= threshold) {
+            continue;
+        }
+        const Int_t windowStart = max(0, i - preSamples);
+        if (windowStart > keptEnd) {
+            fill(samples + keptEnd, samples + windowStart, 0);
+        }
+        keptEnd = max(keptEnd, min(nPoints, i + postSamples + 1));
+    }
+
+    if (keptEnd == 0) {
+        return false;
+    }
+    fill(samples + keptEnd, samples + nPoints, 0);
+
+    return true;
+}
+
+///////////////////////////////////////////////
+/// \brief It merges the deposits of `signals` in a single time ordered array with the cumulative
+/// energies, so that the energy of the deposits inside any time window is a difference of two sums.
+/// The arrays of `index` are reused, so no memory is allocated once they are large enough.
+///
+void TRestDetectorSignalToRawSignalProcess::BuildDepositIndex(
+    const vector<const TRestDetectorSignal*>& signals, DepositIndex& index) {
+    auto& deposits = index.deposits;
+    deposits.clear();
+    for (const auto& signal : signals) {
+        for (int i = 0; i < signal->GetNumberOfPoints(); i++) {
+            deposits.emplace_back(signal->GetTime(i), signal->GetData(i));
+        }
+    }
+    sort(deposits.begin(), deposits.end());
+
+    index.times.resize(deposits.size());
+    index.cumulativeEnergy.resize(deposits.size() + 1);
+    index.cumulativeEnergy[0] = 0;
+    for (size_t i = 0; i < deposits.size(); i++) {
+        index.times[i] = deposits[i].first;
+        index.cumulativeEnergy[i + 1] = index.cumulativeEnergy[i] + deposits[i].second;
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It finds the trigger time of the *integralThreshold* trigger mode. A window of `nPoints / 2`
+/// samples starting at the scanned time is moved in steps of `step`, from `nPoints` samples before
+/// `minTime` to `nPoints` samples after `maxTime`. The last (or the first, if `firstCrossing` is true)
+/// scanned time at which the energy of the deposits inside the window is above `threshold` is returned
+/// in `startTime`. It returns false if the threshold is never crossed.
+///
+/// The window is swept forward over the time ordered deposits with two indices, and the scan stops
+/// once every deposit has left the window. The steps between two changes of the window content are
+/// skipped, reproducing the accumulated `t = t + step` times, so the cost is linear in the number of
+/// deposits instead of the number of steps.
+///
+Bool_t TRestDetectorSignalToRawSignalProcess::FindIntegralThresholdTime(const DepositIndex& deposits,
+                                                                        Double_t minTime, Double_t maxTime,
+                                                                        Double_t sampling, Int_t nPoints,
+                                                                        Double_t step, Double_t threshold,
+                                                                        Bool_t firstCrossing,
+                                                                        Double_t& startTime) {
+    const size_t nDeposits = deposits.times.size();
+    bool thresholdReached = false;
+    size_t first = 0;
+    size_t last = 0;
+    const Double_t halfWindow = (sampling * nPoints) / 2.;
+    const Double_t scanEnd = maxTime + nPoints * sampling;
+    for (Double_t t = minTime - nPoints * sampling; t <= scanEnd; t = t + step) {
+        const Double_t endTime = t + halfWindow;
+        while (last < nDeposits && deposits.times[last] < endTime) {
+            last++;
+        }
+        while (first < nDeposits && deposits.times[first] < t) {
+            first++;
+        }
+        if (first == nDeposits) {
+            // no deposits left, the integral cannot be above threshold anymore
+            break;
+        }
+
+        const Double_t energy =
+            last > first ? deposits.cumulativeEnergy[last] - deposits.cumulativeEnergy[first] : 0;
+        if (energy > threshold) {
+            startTime = t;
+            thresholdReached = true;
+            if (firstCrossing) {
+                break;
+            }
+        }
+
+        // The window content does not change until the next deposit enters or the first one leaves.
+        // Jump to the last step before that, which gets the same energy. The entering edge is rounded
+        // with a margin, so the steps close to it are still scanned one by one.
+        Double_t nextChange = deposits.times[first];
+        if (last < nDeposits) {
+            const Double_t entering = deposits.times[last] - halfWindow;
+            nextChange = min(nextChange, entering - 1E-12 * (abs(deposits.times[last]) + halfWindow));
+        }
+        const Double_t skipped = AdvanceScanTime(t, step, min(nextChange, scanEnd));
+        if (skipped > t && energy > threshold) {
+            startTime = skipped;
+        }
+        t = skipped;
+    }
+    return thresholdReached;
+}
+
+///////////////////////////////////////////////
+/// \brief It finds the trigger time of the *integralThresholdTPC* trigger mode. The trigger time is
+/// scanned in steps of `sampling` from `minTime` up to `maxTime + sampling`, and the first time at
+/// which the energy of the deposits inside the preceding `nPoints` samples reaches `threshold` is
+/// returned in `triggerTime`. It returns false if the threshold is never reached.
+///
+/// The window is swept over the time ordered deposits with two indices. The deposit energies are
+/// positive, so the window energy can only grow when a new deposit enters the window, and the steps
+/// before the next deposit are skipped. The scanned times are accumulated as `time += sampling`, and
+/// the skipped steps reproduce that sum exactly. The cost is linear in the number of deposits.
+///
+Bool_t TRestDetectorSignalToRawSignalProcess::FindIntegralThresholdTPCTime(
+    const DepositIndex& deposits, Double_t minTime, Double_t maxTime, Double_t sampling, Int_t nPoints,
+    Double_t threshold, Double_t& triggerTime) {
+    const size_t nDeposits = deposits.times.size();
+    const Double_t windowLength = sampling * nPoints;
+
+    size_t first = 0;
+    size_t last = 0;
+    for (Double_t time = minTime; time <= maxTime + sampling; time += sampling) {
+        const Double_t startTime = time - windowLength;
+        while (last < nDeposits && deposits.times[last] < time) {
+            last++;
+        }
+        while (first < last && deposits.times[first] < startTime) {
+            first++;
+        }
+        if (deposits.cumulativeEnergy[last] - deposits.cumulativeEnergy[first] >= threshold) {
+            triggerTime = time;
+            return true;
+        }
+        if (last == nDeposits) {
+            break;
+        }
+        // jump to the last step before the next deposit enters the window. The skipped steps are
+        // accumulated with the same rounding, so the trigger time is the one of the full scan.
+        time = AdvanceScanTime(time, sampling, deposits.times[last]);
+    }
+
+    return false;
+}
+
 ///////////////////////////////////////////////
 /// \brief Default constructor
 ///
@@ -171,6 +1026,8 @@ TRestDetectorSignalToRawSignalProcess::TRestDetectorSignalToRawSignalProcess(con
 ///
 TRestDetectorSignalToRawSignalProcess::~TRestDetectorSignalToRawSignalProcess() {
     delete fOutputRawSignalEvent;
+    delete fWindowEvent;
+    StopWorkerPool();
 }
 
 ///////////////////////////////////////////////
@@ -199,6 +1056,188 @@ void TRestDetectorSignalToRawSignalProcess::Initialize() {
 
     fInputSignalEvent = nullptr;
     fOutputRawSignalEvent = new TRestRawSignalEvent();
+    fWindowEvent = nullptr;
+}
+
+///////////////////////////////////////////////
+/// \brief The registry of trigger strategies, indexed by trigger mode. It is initialized with the
+/// trigger modes implemented by this process.
+///
+map<string, TRestDetectorSignalToRawSignalProcess::TriggerStrategy>&
+TRestDetectorSignalToRawSignalProcess::GetTriggerStrategies() {
+    static map<string, TriggerStrategy> strategies = {
+        {"firstDeposit", &TRestDetectorSignalToRawSignalProcess::TriggerFirstDeposit},
+        {"integralThreshold", &TRestDetectorSignalToRawSignalProcess::TriggerIntegralThreshold},
+        {"fixed", &TRestDetectorSignalToRawSignalProcess::TriggerFixed},
+        {"observable", &TRestDetectorSignalToRawSignalProcess::TriggerObservable},
+        {"firstDepositTPC", &TRestDetectorSignalToRawSignalProcess::TriggerFirstDepositTPC},
+        {"integralThresholdTPC", &TRestDetectorSignalToRawSignalProcess::TriggerIntegralThresholdTPC},
+    };
+    return strategies;
+}
+
+///////////////////////////////////////////////
+/// \brief It makes a new trigger strategy available through the *triggerMode* parameter. The strategy
+/// receives the process, from which the input event can be accessed using GetInputSignalEvent, and
+/// must set the time of the bin 0 of the acquisition window (before the trigger delay is applied). It
+/// returns false if the event must be rejected.
+///
+void TRestDetectorSignalToRawSignalProcess::RegisterTriggerStrategy(const string& name,
+                                                                    const TriggerStrategy& strategy) {
+    lock_guard<mutex> lock(triggerStrategiesMutex);
+    GetTriggerStrategies()[name] = strategy;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the names of all the registered trigger strategies
+///
+set<string> TRestDetectorSignalToRawSignalProcess::GetTriggerModes() {
+    lock_guard<mutex> lock(triggerStrategiesMutex);
+    set<string> triggerModes;
+    for (const auto& strategy : GetTriggerStrategies()) {
+        triggerModes.insert(strategy.first);
+    }
+    return triggerModes;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the input signals, in a list reused from one event to the next
+///
+const vector<const TRestDetectorSignal*>& TRestDetectorSignalToRawSignalProcess::GetInputSignals() {
+    fTriggerSignals.clear();
+    for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
+        fTriggerSignals.push_back(fInputSignalEvent->GetSignal(n));
+    }
+    return fTriggerSignals;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the input signals with type "tpc", in a list reused from one event to the next
+///
+const vector<const TRestDetectorSignal*>& TRestDetectorSignalToRawSignalProcess::GetTPCSignals() {
+    fTriggerSignals.clear();
+    for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
+        const TRestDetectorSignal* signal = fInputSignalEvent->GetSignal(n);
+        if (signal->GetSignalType() == "tpc") {
+            fTriggerSignals.push_back(signal);
+        }
+    }
+    return fTriggerSignals;
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::TriggerFirstDeposit(Double_t& startTimeNoOffset) {
+    startTimeNoOffset = fInputSignalEvent->GetMinTime();
+    return true;
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::TriggerIntegralThreshold(Double_t& startTimeNoOffset) {
+    BuildDepositIndex(GetInputSignals(), fTriggerDeposits);
+
+    if (!FindIntegralThresholdTime(fTriggerDeposits, fInputSignalEvent->GetMinTime(),
+                                   fInputSignalEvent->GetMaxTime(), fSampling, fNPoints,
+                                   fIntegralThresholdStep, fIntegralThreshold,
+                                   fIntegralThresholdCrossing == "first", startTimeNoOffset)) {
+        RESTWarning << "Integral threshold for trigger not reached" << RESTendl;
+        startTimeNoOffset = 0;
+    }
+    return true;
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::TriggerFixed(Double_t& startTimeNoOffset) {
+    startTimeNoOffset = fTriggerFixedStartTime;
+    return true;
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::TriggerObservable(Double_t& startTimeNoOffset) {
+    startTimeNoOffset = GetObservableValue<double>(fTriggerModeObservableName);
+    return true;
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::TriggerFirstDepositTPC(Double_t& startTimeNoOffset) {
+    const auto& tpcSignals = GetTPCSignals();
+    if (tpcSignals.empty()) {
+        return false;
+    }
+
+    double startTime = std::numeric_limits<float>::max();
+    for (const auto& signal : tpcSignals) {
+        const auto minTime = signal->GetMinTime();
+        if (minTime < startTime) {
+            startTime = minTime;
+        }
+    }
+
+    if (startTime >= std::numeric_limits<float>::max()) {
+        return false;
+    }
+    startTimeNoOffset = startTime;
+    return true;
+}
+
+Bool_t TRestDetectorSignalToRawSignalProcess::TriggerIntegralThresholdTPC(Double_t& startTimeNoOffset) {
+    const auto& tpcSignals = GetTPCSignals();
+    if (tpcSignals.empty()) {
+        return false;
+    }
+
+    RESTDebug << "TRestDetectorSignalToRawSignalProcess::TriggerIntegralThresholdTPC: "
+              << "Trigger mode integralThresholdTPC" << RESTendl;
+
+    if (fIntegralThresholdTPCkeV <= 0) {
+        RESTError << "TRestDetectorSignalToRawSignalProcess::TriggerIntegralThresholdTPC: "
+                  << "integralThresholdTPCkeV must be greater than 0: " << fIntegralThresholdTPCkeV
+                  << RESTendl;
+        exit(1);
+    }
+
+    double totalEnergy = 0;
+    for (const auto& signal : tpcSignals) {
+        totalEnergy += signal->GetIntegral();
+    }
+    if (totalEnergy < fIntegralThresholdTPCkeV) {
+        return false;
+    }
+
+    Double_t maxTime = std::numeric_limits<Double_t>::min();
+    Double_t minTime = std::numeric_limits<Double_t>::max();
+    for (const auto& signal : tpcSignals) {
+        const auto maxSignalTime = signal->GetMaxTime();
+        if (maxSignalTime > maxTime) {
+            maxTime = maxSignalTime;
+        }
+        const auto minSignalTime = signal->GetMinTime();
+        if (minSignalTime < minTime) {
+            minTime = minSignalTime;
+        }
+
+        if (minSignalTime < 0) {
+            RESTWarning << "TRestDetectorSignalToRawSignalProcess::TriggerIntegralThresholdTPC: EventID: "
+                        << fInputSignalEvent->GetID() << " signal ID: " << signal->GetSignalID()
+                        << " minSignalTime < 0. MinSignalTime: " << minSignalTime << RESTendl;
+            signal->Print();
+            return false;
+        }
+    }
+
+    if (minTime > maxTime || minTime < 0) {
+        RESTWarning << "TRestDetectorSignalToRawSignalProcess::TriggerIntegralThresholdTPC: EventID: "
+                    << fInputSignalEvent->GetID()
+                    << " minTime > maxTime or minTime < 0. MinTime: " << minTime
+                    << " MaxTime: " << maxTime << RESTendl;
+        return false;
+    }
+
+    BuildDepositIndex(tpcSignals, fTriggerDeposits);
+
+    Double_t triggerTime = 0;
+    if (!FindIntegralThresholdTPCTime(fTriggerDeposits, minTime, maxTime, fSampling, fNPoints,
+                                      fIntegralThresholdTPCkeV, triggerTime)) {
+        return false;
+    }
+
+    fTriggerTime = triggerTime;
+    startTimeNoOffset = triggerTime;
+    return true;
 }
 
 ///////////////////////////////////////////////
@@ -207,6 +1246,10 @@ void TRestDetectorSignalToRawSignalProcess::Initialize() {
 TRestEvent* TRestDetectorSignalToRawSignalProcess::ProcessEvent(TRestEvent* inputEvent) {
     fInputSignalEvent = (TRestDetectorSignalEvent*)inputEvent;
 
+    if (fStreaming) {
+        return ProcessStreamEvent();
+    }
+
     if (fInputSignalEvent->GetNumberOfSignals() <= 0) {
         return nullptr;
     }
@@ -220,305 +1263,1013 @@ TRestEvent* TRestDetectorSignalToRawSignalProcess::ProcessEvent(TRestEvent* inpu
     fOutputRawSignalEvent->SetTimeStamp(fInputSignalEvent->GetTimeStamp());
     fOutputRawSignalEvent->SetSubEventTag(fInputSignalEvent->GetSubEventTag());
 
-    double triggerTime = 0;
-    double startTimeNoOffset = 0;
+    fTriggerTime = 0;
+    Double_t startTimeNoOffset = 0;
+    if (!fTriggerStrategy(*this, startTimeNoOffset)) {
+        return nullptr;
+    }
+
+    FindTriggerWindows(startTimeNoOffset);
+    if (fTriggerWindows > 1) {
+        fOutputRawSignalEvent->SetSubID(0);
+    }
+    FillRawSignalEvent(fOutputRawSignalEvent, 0);
+
+    // the signals of the other windows are added to the output event with shifted signal IDs
+    for (size_t window = 1; window < fTriggerWindowTimes.size(); window++) {
+        TRestRawSignalEvent* windowEvent = GetWindowEvent(window);
+        for (int n = 0; n < windowEvent->GetNumberOfSignals(); n++) {
+            TRestRawSignal* signal = windowEvent->GetSignal(n);
+            signal->SetSignalID(signal->GetSignalID() + window * fTriggerWindowIDOffset);
+            fOutputRawSignalEvent->AddSignal(*signal);
+        }
+        if (!windowEvent->isOk()) {
+            fOutputRawSignalEvent->SetOK(false);
+        }
+    }
+
+    if (fOutputRawSignalEvent->GetNumberOfSignals() == 0) {
+        RESTDebug << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: all the signals are below the "
+                  << "early rejection or the zero suppression thresholds" << RESTendl;
+        return nullptr;
+    }
+
+    SetObservableValue("triggerTimeTPC", fTriggerTime);
+    SetObservableValue("nTriggerWindows", (Int_t)fTriggerWindowTimes.size());
+
+    RESTDebug << "TRestDetectorSignalToRawSignalProcess. Returning event with N signals "
+              << fOutputRawSignalEvent->GetNumberOfSignals() << RESTendl;
+
+    return fOutputRawSignalEvent;
+}
+
+///////////////////////////////////////////////
+/// \brief The ProcessEvent implementation of the streaming mode. The deposits of the input event are
+/// added to the stream buffer, the triggers are searched up to the start time of the next event and all
+/// the complete frames are written to the output event.
+///
+TRestEvent* TRestDetectorSignalToRawSignalProcess::ProcessStreamEvent() {
+    const Double_t frameLength = fNPoints * fSampling;
+    const Double_t eventSpacing = fStreamEventSpacing > 0 ? fStreamEventSpacing : frameLength;
+    const Double_t deadTime = fStreamDeadTime > 0 ? fStreamDeadTime : frameLength;
+    const Double_t triggerWindow = frameLength / 2;
+
+    // the frames of the readout types with a larger sampling extend further around the trigger
+    Double_t maxSampling = fSampling;
+    for (const auto& parameters : fParametersMap) {
+        maxSampling = max(maxSampling, parameters.second.sampling);
+    }
+    const Double_t preTrigger = fTriggerDelay * maxSampling;
+    const Double_t postTrigger = (fNPoints - fTriggerDelay) * maxSampling;
+
+    const Double_t eventTime = fStreamEvents * eventSpacing;
+    fStreamEvents++;
+
+    const size_t nPrevious = fStreamDeposits.size();
+    for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
+        const TRestDetectorSignal* signal = fInputSignalEvent->GetSignal(n);
+        const auto signalType = signal->GetSignalType();
+        const Int_t type = find(fStreamSignalTypes.begin(), fStreamSignalTypes.end(), signalType) -
+                           fStreamSignalTypes.begin();
+        if (type == (Int_t)fStreamSignalTypes.size()) {
+            fStreamSignalTypes.push_back(signalType);
+        }
+        for (int m = 0; m < signal->GetNumberOfPoints(); m++) {
+            fStreamDeposits.push_back(
+                {eventTime + signal->GetTime(m), signal->GetSignalID(), signal->GetData(m), type});
+        }
+    }
+    sort(fStreamDeposits.begin() + nPrevious, fStreamDeposits.end());
+    inplace_merge(fStreamDeposits.begin(), fStreamDeposits.begin() + nPrevious, fStreamDeposits.end());
+
+    while (fStreamDeposits.size() > (size_t)fStreamBufferSize) {
+        if (!fStreamTriggers.empty() &&
+            fStreamDeposits.front().time >= fStreamTriggers.front() - preTrigger) {
+            // the oldest deposit belongs to the oldest pending frame, which is dropped as a whole
+            fStreamTriggers.pop_front();
+            fStreamDroppedFrames++;
+            continue;
+        }
+        fStreamDeposits.pop_front();
+        fStreamDroppedDeposits++;
+    }
+
+    // Deposits of the next events cannot be earlier than the next event start. After the last entry of
+    // the run there are no next events, and all the pending frames are complete.
+    const bool streamEnd = fStreamEndEvent > 0 && fStreamEvents >= fStreamEndEvent;
+    const Double_t horizon = streamEnd ? numeric_limits<Double_t>::max() : fStreamEvents * eventSpacing;
+
+    // The windows [t, t + triggerWindow) starting at each deposit are swept once all their deposits are
+    // known, and a trigger is issued at the start of the window when its integral is above the threshold,
+    // as in the integralThreshold trigger mode.
+    const auto earlierThan = [](const StreamDeposit& deposit, Double_t time) { return deposit.time < time; };
+    auto start = lower_bound(fStreamDeposits.begin(), fStreamDeposits.end(), fStreamScanTime, earlierThan);
+    auto last = start;
+    Double_t integral = 0;
+    while (start != fStreamDeposits.end() && start->time + triggerWindow <= horizon) {
+        const Double_t time = start->time;
+        for (; last != fStreamDeposits.end() && last->time < time + triggerWindow; last++) {
+            integral += last->energy;
+        }
+        if (integral > fIntegralThreshold && time >= fStreamLastTrigger + deadTime) {
+            fStreamTriggers.push_back(time);
+            fStreamLastTrigger = time;
+        }
+        for (; start != fStreamDeposits.end() && start->time == time; start++) {
+            integral -= start->energy;
+        }
+    }
+    fStreamScanTime = start != fStreamDeposits.end() ? start->time : horizon;
+
+    // Every complete frame is synthesized. The first one is the output event, with the frame number as
+    // SubID, and the signals of the next ones are added to it with their IDs shifted by multiples of
+    // triggerWindowIDOffset.
+    Int_t nFrames = 0;
+    while (!fStreamTriggers.empty() && fStreamTriggers.front() + postTrigger <= horizon) {
+        const Double_t triggerTime = fStreamTriggers.front();
+        fStreamTriggers.pop_front();
+
+        fStreamFrameEvent.Initialize();
+        fStreamFrameEvent.SetID(fInputSignalEvent->GetID());
+        const Double_t frameStart = triggerTime - preTrigger;
+        auto deposit = lower_bound(fStreamDeposits.begin(), fStreamDeposits.end(), frameStart, earlierThan);
+        for (; deposit != fStreamDeposits.end() && deposit->time < triggerTime + postTrigger; deposit++) {
+            const Int_t nSignals = fStreamFrameEvent.GetNumberOfSignals();
+            fStreamFrameEvent.AddChargeToSignal(deposit->signalID, deposit->time, deposit->energy);
+            if (fStreamFrameEvent.GetNumberOfSignals() > nSignals) {
+                // a new signal, its type selects the readout parameters
+                fStreamFrameEvent.GetSignal(nSignals)->SetSignalType(fStreamSignalTypes[deposit->type]);
+            }
+        }
+
+        if (fWindowEvent == nullptr) {
+            fWindowEvent = new TRestRawSignalEvent();
+        }
+        TRestRawSignalEvent* frameEvent = nFrames == 0 ? fOutputRawSignalEvent : fWindowEvent;
+        frameEvent->SetID(fInputSignalEvent->GetID());
+        frameEvent->SetSubID(fStreamFrames);
+        frameEvent->SetTimeStamp(fInputSignalEvent->GetTimeStamp());
+        frameEvent->SetSubEventTag(fInputSignalEvent->GetSubEventTag());
+
+        TRestDetectorSignalEvent* inputSignalEvent = fInputSignalEvent;
+        fInputSignalEvent = &fStreamFrameEvent;
+        fTriggerWindowTimes.assign(1, triggerTime);
+        FillRawSignalEvent(frameEvent, 0);
+        fInputSignalEvent = inputSignalEvent;
+
+        if (nFrames == 0) {
+            SetObservableValue("streamFrameTime", triggerTime);
+        } else {
+            for (int n = 0; n < frameEvent->GetNumberOfSignals(); n++) {
+                TRestRawSignal* signal = frameEvent->GetSignal(n);
+                signal->SetSignalID(signal->GetSignalID() + nFrames * fTriggerWindowIDOffset);
+                fOutputRawSignalEvent->AddSignal(*signal);
+            }
+            if (!frameEvent->isOk()) {
+                fOutputRawSignalEvent->SetOK(false);
+            }
+        }
+        fStreamFrames++;
+        nFrames++;
+    }
+
+    // the frames waiting for the next events beyond the queue size are dropped, as by a busy DAQ
+    while ((Int_t)fStreamTriggers.size() > fStreamMaxPendingFrames) {
+        fStreamTriggers.pop_back();
+        fStreamDroppedFrames++;
+    }
+
+    // the deposits before the pending frames and the frames of the next triggers are not needed anymore
+    Double_t oldestNeeded = fStreamScanTime - preTrigger;
+    if (!fStreamTriggers.empty()) {
+        oldestNeeded = min(oldestNeeded, fStreamTriggers.front() - preTrigger);
+    }
+    while (!fStreamDeposits.empty() && fStreamDeposits.front().time < oldestNeeded) {
+        fStreamDeposits.pop_front();
+    }
+
+    SetObservableValue("streamFrames", nFrames);
+    SetObservableValue("streamPendingFrames", (Int_t)fStreamTriggers.size());
+    SetObservableValue("streamDroppedFrames", fStreamDroppedFrames);
+    SetObservableValue("streamDroppedDeposits", fStreamDroppedDeposits);
+
+    if (nFrames == 0 || fOutputRawSignalEvent->GetNumberOfSignals() == 0) {
+        return nullptr;
+    }
+    return fOutputRawSignalEvent;
+}
+
+///////////////////////////////////////////////
+/// \brief It fills `event` with the raw signals of the trigger window `window` of the current input
+/// event. It returns the number of input signals not written, because they were skipped by the early
+/// rejection or removed by the zero suppression.
+///
+Int_t TRestDetectorSignalToRawSignalProcess::FillRawSignalEvent(TRestRawSignalEvent* event, size_t window) {
+    const Double_t startTimeNoOffset = fTriggerWindowTimes[window];
+
+    NoiseStream noiseStream;
+    noiseStream.seed = fNoiseSeed;
+    noiseStream.runID = fRunNumber;
+    noiseStream.eventID = fInputSignalEvent->GetID();
+    noiseStream.subEventID = event->GetSubID();
+
+    // the parameters are resolved here, since their look up may write warnings and the synthesis may be
+    // shared among several threads
+    fEventParameters.resize(fInputSignalEvent->GetNumberOfSignals());
+    fEventSkipped.resize(fInputSignalEvent->GetNumberOfSignals());
+    for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
+        const TRestDetectorSignal* signal = fInputSignalEvent->GetSignal(n);
+        const Parameters& parameters = GetSignalParameters(signal);
+        fEventParameters[n] = &parameters;
+        fEventSkipped[n] = parameters.earlyRejectionThreshold > 0 &&
+                           GetPulseAmplitudeBound(signal, parameters, startTimeNoOffset) <=
+                               parameters.earlyRejectionThreshold;
+
+        const double sampling = parameters.sampling;
+        const double timeStart = startTimeNoOffset - fTriggerDelay * sampling;
+        RESTDebug << "fTimeStart: " << timeStart << " us " << RESTendl;
+        RESTDebug << "fTimeEnd: " << timeStart + fNPoints * sampling << " us " << RESTendl;
+
+        if (timeStart + fTriggerDelay * sampling < 0) {
+            // This means something is wrong (negative times somewhere). This should never happen
+            cerr << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
+                 << "fTimeStart < - fTriggerDelay * fSampling" << endl;
+            exit(1);
+        }
+
+        // TODO: time offset may not be working correctly
+        // TODO: event drawing not working correctly (some signals are clipped)
+
+        if (timeStart + fTriggerDelay * fSampling < 0) {
+            // This means something is wrong (negative times somewhere). This should never happen
+            RESTError << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
+                      << "fTimeStart < - fTriggerDelay * fSampling" << RESTendl;
+            exit(1);
+        }
+    }
+
+    SynthesizeSignals(startTimeNoOffset, noiseStream);
+
+    Int_t suppressedSignals = 0;
+    Int_t rejectedSignals = 0;
+    fEventWritten.clear();
+    for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
+        if (fEventSkipped[n]) {
+            rejectedSignals++;
+            continue;
+        }
+
+        const Int_t signalID = fInputSignalEvent->GetSignal(n)->GetSignalID();
+        Short_t* samples = fEventSamples.data() + (size_t)n * fNPoints;
+
+        const Parameters& parameters = *fEventParameters[n];
+        if (parameters.zeroSuppressionThreshold > 0 &&
+            !ZeroSuppress(samples, fNPoints, parameters.calibrationOffset + GetChannelOffset(signalID),
+                          parameters.zeroSuppressionThreshold, parameters.zeroSuppressionPreSamples,
+                          parameters.zeroSuppressionPostSamples)) {
+            suppressedSignals++;
+            continue;
+        }
+        fEventWritten.push_back(n);
+    }
+
+    // When the event still holds the signals of the same channels, they are overwritten in place. Their
+    // sample arrays keep their capacity, so no memory is allocated. Otherwise the event is cleared,
+    // keeping the header already set by the caller, and the signals are added.
+    bool reuseSignals = event->GetNumberOfSignals() == (Int_t)fEventWritten.size();
+    for (size_t k = 0; reuseSignals && k < fEventWritten.size(); k++) {
+        reuseSignals = event->GetSignal(k)->GetSignalID() ==
+                       fInputSignalEvent->GetSignal(fEventWritten[k])->GetSignalID();
+    }
+    if (!reuseSignals && event->GetNumberOfSignals() > 0) {
+        const Int_t id = event->GetID();
+        const Int_t subID = event->GetSubID();
+        const auto timeStamp = event->GetTimeStamp();
+        const TString subEventTag = event->GetSubEventTag();
+        event->Initialize();
+        event->SetID(id);
+        event->SetSubID(subID);
+        event->SetTimeStamp(timeStamp);
+        event->SetSubEventTag(subEventTag);
+    }
+    event->SetOK(true);
+
+    for (size_t k = 0; k < fEventWritten.size(); k++) {
+        const Int_t n = fEventWritten[k];
+        const Int_t signalID = fInputSignalEvent->GetSignal(n)->GetSignalID();
+        const Short_t* samples = fEventSamples.data() + (size_t)n * fNPoints;
+
+        if (fEventClipped[n]) {
+            RESTDebug << "Signal " << signalID << " has values outside short range ("
+                      << numeric_limits<Short_t>::min() << ", " << numeric_limits<Short_t>::max() << ")"
+                      << RESTendl;
+            event->SetOK(false);
+        }
+
+        TRestRawSignal* rawSignal = reuseSignals ? event->GetSignal(k) : &fRawSignal;
+        rawSignal->Initialize();
+        rawSignal->SetSignalID(signalID);
+        for (int x = 0; x < fNPoints; x++) {
+            rawSignal->AddPoint(samples[x]);
+        }
+
+        if (GetVerboseLevel() >= TRestStringOutput::REST_Verbose_Level::REST_Debug) {
+            rawSignal->Print();
+        }
+
+        if (!reuseSignals) {
+            RESTDebug << "Adding signal to raw signal event" << RESTendl;
+            event->AddSignal(fRawSignal);
+        }
+    }
+
+    // the observables describe the process output, the extra windows must not overwrite them
+    if (window == 0) {
+        SetObservableValue(zeroSuppressedSignalsObservable, suppressedSignals);
+        SetObservableValue(earlyRejectedSignalsObservable, rejectedSignals);
+    }
+
+    return rejectedSignals + suppressedSignals;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns an upper bound of the amplitude over the offset, in ADC units and without noise,
+/// of the raw signal synthesized from `signal`. It is the sum of the deposits inside the acquisition
+/// window times the gain and the absolute maximum of the shaping function, and it only requires one
+/// pass over the signal points.
+///
+Double_t TRestDetectorSignalToRawSignalProcess::GetPulseAmplitudeBound(const TRestDetectorSignal* signal,
+                                                                       const Parameters& parameters,
+                                                                       Double_t startTimeNoOffset) const {
+    const Double_t timeStart = startTimeNoOffset - fTriggerDelay * parameters.sampling;
+    const Double_t timeEnd = timeStart + fNPoints * parameters.sampling;
+
+    Double_t energy = 0;
+    for (int m = 0; m < signal->GetNumberOfPoints(); m++) {
+        const Double_t t = signal->GetTime(m);
+        if (t > timeStart && t < timeEnd && signal->GetData(m) > 0) {
+            energy += signal->GetData(m);
+        }
+    }
+
+    const Double_t shapingMaximum = parameters.HasShaping() ? parameters.shapingKernelMaximum : 1.0;
+    return energy * parameters.calibrationGain * GetChannelGain(signal->GetSignalID()) * shapingMaximum;
+}
+
+///////////////////////////////////////////////
+/// \brief It finds the trigger windows of the current input event. The first one is the window defined
+/// by the trigger mode. If *triggerWindows* is larger than 1, the deposits of all the signals are swept
+/// once in time order, and each new window is triggered by the first deposit after the end of the
+/// previous window, as for the *firstDeposit* trigger mode.
+///
+void TRestDetectorSignalToRawSignalProcess::FindTriggerWindows(Double_t startTimeNoOffset) {
+    fTriggerWindowTimes.assign(1, startTimeNoOffset);
+    if (fTriggerWindows <= 1) {
+        return;
+    }
+
+    BuildDepositIndex(GetInputSignals(), fTriggerDeposits);
+    const auto& deposits = fTriggerDeposits;
+    const size_t nDeposits = deposits.times.size();
+
+    size_t i = 0;
+    while ((Int_t)fTriggerWindowTimes.size() < fTriggerWindows) {
+        const Double_t windowEnd = fTriggerWindowTimes.back() + (fNPoints - fTriggerDelay) * fSampling;
+        while (i < nDeposits && (deposits.times[i] < windowEnd ||
+                                 deposits.cumulativeEnergy[i + 1] <= deposits.cumulativeEnergy[i])) {
+            i++;
+        }
+        if (i == nDeposits) {
+            break;
+        }
+        fTriggerWindowTimes.push_back(deposits.times[i]);
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the raw signal event of the trigger window `window` of the last processed event,
+/// or nullptr if there is no such window. Window 0 is the process output event. The other windows
+/// are synthesized on request into an event owned by the process, with the window index as SubID.
+/// It must be called after ProcessEvent, while its input event is still valid.
+///
+TRestRawSignalEvent* TRestDetectorSignalToRawSignalProcess::GetWindowEvent(Int_t window) {
+    if (window < 0 || window >= (Int_t)fTriggerWindowTimes.size()) {
+        return nullptr;
+    }
+    if (window == 0) {
+        return fOutputRawSignalEvent;
+    }
+
+    if (fWindowEvent == nullptr) {
+        fWindowEvent = new TRestRawSignalEvent();
+    }
+    fWindowEvent->SetID(fInputSignalEvent->GetID());
+    fWindowEvent->SetSubID(window);
+    fWindowEvent->SetTimeStamp(fInputSignalEvent->GetTimeStamp());
+    fWindowEvent->SetSubEventTag(fInputSignalEvent->GetSubEventTag());
+    FillRawSignalEvent(fWindowEvent, window);
+
+    return fWindowEvent;
+}
+
+/// The synthesis job of an event is shared by the process thread and the workers, which take chunks of
+/// signals from a common counter. The workers wait for the next job between events.
+struct TRestDetectorSignalToRawSignalProcess::WorkerPool {
+    /// Number of signals taken by a thread each time
+    static constexpr int chunkSize = 8;
+
+    explicit WorkerPool(TRestDetectorSignalToRawSignalProcess* process) : process(process) {}
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(jobMutex);
+            stop = true;
+        }
+        jobStart.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /// It starts the workers missing to have at least `nWorkers`
+    void Resize(size_t nWorkers) {
+        lock_guard<mutex> lock(jobMutex);
+        while (threads.size() < nWorkers) {
+            threads.emplace_back(&WorkerPool::Run, this, threads.size(), job);
+        }
+    }
+
+    /// It runs the current job with `nWorkers` workers and the calling thread, using the scratch buffers
+    /// of the process (one more than `nWorkers`). It returns once all the signals are synthesized.
+    void Execute(size_t nWorkers) {
+        nextSignal = 0;
+        if (nWorkers == 0) {
+            Synthesize(process->fSynthesisBuffers[0]);
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(jobMutex);
+            activeWorkers = nWorkers;
+            running = threads.size();
+            job++;
+        }
+        jobStart.notify_all();
+        Synthesize(process->fSynthesisBuffers[0]);
+
+        unique_lock<mutex> lock(jobMutex);
+        jobDone.wait(lock, [this] { return running == 0; });
+    }
+
+    void Run(size_t worker, Long64_t lastJob) {
+        unique_lock<mutex> lock(jobMutex);
+        while (true) {
+            jobStart.wait(lock, [this, lastJob] { return stop || job != lastJob; });
+            if (stop) {
+                return;
+            }
+            lastJob = job;
+            const bool active = worker < activeWorkers;
+            lock.unlock();
+            if (active) {
+                Synthesize(process->fSynthesisBuffers[worker + 1]);
+            }
+            lock.lock();
+            if (--running == 0) {
+                jobDone.notify_one();
+            }
+        }
+    }
+
+    void Synthesize(SynthesisBuffers& buffers) {
+        const int nSignals = process->fInputSignalEvent->GetNumberOfSignals();
+        NoiseStream stream = noiseStream;
+        for (int first = nextSignal.fetch_add(chunkSize); first < nSignals;
+             first = nextSignal.fetch_add(chunkSize)) {
+            for (int n = first; n < min(nSignals, first + chunkSize); n++) {
+                if (process->fEventSkipped[n]) {
+                    continue;
+                }
+                const TRestDetectorSignal* signal = process->fInputSignalEvent->GetSignal(n);
+                stream.signalID = signal->GetSignalID();
+                process->fEventClipped[n] = !process->SynthesizeSignal(
+                    signal, *process->fEventParameters[n], startTimeNoOffset, stream, buffers,
+                    process->fEventSamples.data() + (size_t)n * process->fNPoints);
+            }
+        }
+    }
+
+    TRestDetectorSignalToRawSignalProcess* process;
+    vector<thread> threads;
+    mutex jobMutex;
+    condition_variable jobStart;
+    condition_variable jobDone;
+    /// Incremented for each job given to the workers
+    Long64_t job = 0;
+    /// Number of workers which have not finished the current job yet
+    size_t running = 0;
+    bool stop = false;
+
+    /// The current job: number of workers taking part, window start time, noise stream of the event and
+    /// next signal to synthesize
+    size_t activeWorkers = 0;
+    Double_t startTimeNoOffset = 0;
+    NoiseStream noiseStream;
+    atomic<int> nextSignal{0};
+};
+
+///////////////////////////////////////////////
+/// \brief It stops the synthesis threads, which are started again by the next event.
+///
+void TRestDetectorSignalToRawSignalProcess::StopWorkerPool() {
+    delete fWorkerPool;
+    fWorkerPool = nullptr;
+}
+
+///////////////////////////////////////////////
+/// \brief It synthesizes the raw signals of all the input signals into fEventSamples, in input signal
+/// order, and flags the clipped ones in fEventClipped. If *channelThreads* is larger than 1 the signals
+/// are shared among several threads, kept alive from one event to the next. Each signal has its own
+/// noise stream and the results are stored by signal index, so the output does not depend on the number
+/// of threads. The parameters of each signal must have been resolved in fEventParameters, and the
+/// threads only read the process members.
+///
+void TRestDetectorSignalToRawSignalProcess::SynthesizeSignals(Double_t startTimeNoOffset,
+                                                              const NoiseStream& eventNoiseStream) {
+    // minimum number of signals per thread to use a new thread
+    constexpr int minSignalsPerThread = 4 * WorkerPool::chunkSize;
+
+    const int nSignals = fInputSignalEvent->GetNumberOfSignals();
+    fEventSamples.resize((size_t)nSignals * fNPoints);
+    fEventClipped.resize(nSignals);
+
+    const int nThreads = max(1, min(fChannelThreads, nSignals / minSignalsPerThread));
+    if ((int)fSynthesisBuffers.size() < nThreads) {
+        fSynthesisBuffers.resize(nThreads);
+    }
+
+    if (fWorkerPool == nullptr) {
+        fWorkerPool = new WorkerPool(this);
+    }
+    fWorkerPool->Resize(nThreads - 1);
+    fWorkerPool->startTimeNoOffset = startTimeNoOffset;
+    fWorkerPool->noiseStream = eventNoiseStream;
+    fWorkerPool->Execute(nThreads - 1);
+}
 
-    if (fTriggerMode == "firstDeposit") {
-        startTimeNoOffset = fInputSignalEvent->GetMinTime();
-    } else if (fTriggerMode == "integralThreshold") {
-        bool thresholdReached = false;
-        for (Double_t t = fInputSignalEvent->GetMinTime() - fNPoints * fSampling;
-             t <= fInputSignalEvent->GetMaxTime() + fNPoints * fSampling; t = t + 0.5) {
-            Double_t energy = fInputSignalEvent->GetIntegralWithTime(t, t + (fSampling * fNPoints) / 2.);
+///////////////////////////////////////////////
+/// \brief It synthesizes the raw signal samples of one detector signal: binning of the deposits inside
+/// the acquisition window, noise, shaping and conversion to ADC counts, which are written to `output`
+/// (fNPoints samples). All the intermediate waveforms are stored in `buffers`, so no memory is allocated
+/// once the buffers have grown to fNPoints. It returns false if any sample exceeded the Short_t range.
+///
+Bool_t TRestDetectorSignalToRawSignalProcess::SynthesizeSignal(
+    const TRestDetectorSignal* signal, const Parameters& parameters, Double_t startTimeNoOffset,
+    const NoiseStream& noiseStream, SynthesisBuffers& buffers, Short_t* output) const {
+    if (parameters.singlePrecision) {
+        return SynthesizeWaveform(signal, parameters, startTimeNoOffset, noiseStream, buffers.dataFloat,
+                                  buffers.depositsFloat, buffers.shapedFloat, buffers.occupiedBins,
+                                  buffers.spectrum, output);
+    }
+    return SynthesizeWaveform(signal, parameters, startTimeNoOffset, noiseStream, buffers.data,
+                              buffers.deposits, buffers.shaped, buffers.occupiedBins, buffers.spectrum,
+                              output);
+}
 
-            if (energy > fIntegralThreshold) {
-                startTimeNoOffset = t;
-                thresholdReached = true;
+///////////////////////////////////////////////
+/// \brief It implements SynthesizeSignal, with the intermediate waveforms in double or single
+/// precision.
+///
+template <typename T>
+Bool_t TRestDetectorSignalToRawSignalProcess::SynthesizeWaveform(
+    const TRestDetectorSignal* signal, const Parameters& parameters, Double_t startTimeNoOffset,
+    const NoiseStream& noiseStream, vector<T>& data, vector<T>& deposits, vector<T>& shaped,
+    vector<Int_t>& occupiedBins, vector<complex<Double_t>>& spectrum, Short_t* output) const {
+    const Double_t sampling = parameters.sampling;
+    const Double_t calibrationGain = parameters.calibrationGain * GetChannelGain(signal->GetSignalID());
+    const Double_t calibrationOffset =
+        parameters.calibrationOffset + GetChannelOffset(signal->GetSignalID());
+    const Double_t noiseLevel = parameters.noiseLevel;
+    const Double_t timeStart = startTimeNoOffset - fTriggerDelay * sampling;
+    const Double_t timeEnd = timeStart + fNPoints * sampling;
+
+    data.assign(fNPoints, calibrationOffset);
+
+    for (int m = 0; m < signal->GetNumberOfPoints(); m++) {
+        const Double_t t = signal->GetTime(m);
+        if (t > timeStart && t < timeEnd) {
+            // convert physical time (in us) to timeBin
+            const auto timeBin = (Int_t)round((t - timeStart) / sampling);
+            // deposits within half a sample of timeEnd would fall in the bin after the window
+            if (timeBin < fNPoints) {
+                data[timeBin] += calibrationGain * signal->GetData(m);
             }
         }
-        if (!thresholdReached) {
-            RESTWarning << "Integral threshold for trigger not reached" << RESTendl;
-            startTimeNoOffset = 0;
-        }
-    } else if (fTriggerMode == "observable") {
-        const auto obs = GetObservableValue<double>(fTriggerModeObservableName);
-        startTimeNoOffset = obs;
+    }
 
-    } else if (fTriggerMode == "firstDepositTPC" || fTriggerMode == "integralThresholdTPC") {
-        fReadout = GetMetadata<TRestDetectorReadout>();
+    NoiseStream stream = noiseStream;
+    const bool gaussianNoise = noiseLevel > 0 && fNoiseLibraryWaveforms == nullptr;
 
-        if (fReadout == nullptr) {
-            RESTError << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-                      << "TRestDetectorReadout metadata not found" << RESTendl;
-            exit(1);
-        }
+    // Noise before shaping
+    if (gaussianNoise) {
+        stream.stage = 0;
+        AddNoise(data.data(), fNPoints, noiseLevel, stream);
+    }
 
-        set<const TRestDetectorSignal*> tpcSignals;
+    if (parameters.HasShaping()) {
+        const T offset = calibrationOffset;
+        deposits.resize(fNPoints);
+        shaped.resize(fNPoints);
+        for (int i = 0; i < fNPoints; i++) {
+            deposits[i] = data[i] - offset;
+        }
 
-        for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
-            TRestDetectorSignal* signal = fInputSignalEvent->GetSignal(n);
-            if (signal->GetSignalType() == "tpc") {
-                tpcSignals.insert(signal);
-            }
-            /*
-            const auto allDaqIds = fReadout->GetAllDaqIds();
-            for (const auto& daqId : allDaqIds) {
-                const auto& channel = fReadout->GetReadoutChannelWithDaqID(daqId);
-                // TODO: sometimes channel type does not match signal type, why?
-            }
-            */
+        ShapeSignal(deposits.data(), shaped.data(), parameters, occupiedBins, spectrum);
+        for (int i = 0; i < fNPoints; i++) {
+            data[i] = shaped[i] + offset;
         }
 
-        if (tpcSignals.empty()) {
-            return nullptr;
+        // Noise after shaping
+        if (gaussianNoise) {
+            stream.stage = 1;
+            AddNoise(data.data(), fNPoints, noiseLevel, stream);
         }
+    }
 
-        if (fTriggerMode == "firstDepositTPC") {
-            double startTime = std::numeric_limits<float>::max();
-            for (const auto& signal : tpcSignals) {
-                const auto minTime = signal->GetMinTime();
-                if (minTime < startTime) {
-                    startTime = minTime;
-                }
-            }
+    if (fNoiseLibraryWaveforms != nullptr && noiseLevel > 0) {
+        stream.stage = 2;
+        AddLibraryNoise(data.data(), fNPoints, *fNoiseLibraryWaveforms, fNoiseLibraryLength, stream);
+    }
 
-            if (startTime >= std::numeric_limits<float>::max()) {
-                return nullptr;
-            }
-            startTimeNoOffset = startTime;
+    return !QuantizeToADC(data.data(), output, fNPoints);
+}
 
-        } else if (fTriggerMode == "integralThresholdTPC") {
-            RESTDebug << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-                      << "Trigger mode integralThresholdTPC" << RESTendl;
+///////////////////////////////////////////////
+/// \brief It returns the parameters of the type of a signal, given by its signal type as in the trigger
+/// modes. They are kept in a table indexed by signal (DAQ) ID, filled the first time each ID is seen. The
+/// entries taken from the readout are replaced, with a warning, when the readout channel type disagrees
+/// with the signal type. Unknown types use the default parameters.
+///
+const TRestDetectorSignalToRawSignalProcess::Parameters&
+TRestDetectorSignalToRawSignalProcess::GetSignalParameters(const TRestDetectorSignal* signal) {
+    const Int_t signalID = signal->GetSignalID();
+    const string type = signal->GetSignalType();
+    const bool known = signalID >= 0 && signalID < (Int_t)fParametersBySignalID.size() &&
+                       fParametersBySignalID[signalID] != nullptr;
+    if (known && fTypeBySignalID[signalID] == type) {
+        return *fParametersBySignalID[signalID];
+    }
+    if (known) {
+        RESTWarning << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: signal " << signalID
+                    << " has type " << type << " but readout channel type " << fTypeBySignalID[signalID]
+                    << ", using the signal type" << RESTendl;
+    }
 
-            if (fIntegralThresholdTPCkeV <= 0) {
-                RESTError << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-                          << "integralThresholdTPCkeV must be greater than 0: " << fIntegralThresholdTPCkeV
-                          << RESTendl;
-                exit(1);
-            }
+    auto parameters = fParametersMap.find(type);
+    if (parameters == fParametersMap.end()) {
+        RESTWarning << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
+                    << "type " << type << " not found in parameters map" << RESTendl;
+        parameters = fParametersMap.find("");
+    }
+    if (signalID >= 0) {
+        if (signalID >= (Int_t)fParametersBySignalID.size()) {
+            fParametersBySignalID.resize(signalID + 1, nullptr);
+            fTypeBySignalID.resize(signalID + 1);
+        }
+        fParametersBySignalID[signalID] = &parameters->second;
+        fTypeBySignalID[signalID] = type;
+    }
+    return parameters->second;
+}
 
-            double totalEnergy = 0;
-            for (const auto& signal : tpcSignals) {
-                totalEnergy += signal->GetIntegral();
-            }
-            if (totalEnergy < fIntegralThresholdTPCkeV) {
-                return nullptr;
-            }
+///////////////////////////////////////////////
+/// \brief It fills the table pointing each readout channel DAQ ID to the parameters of its readout type.
+/// GetSignalParameters checks these entries against the signal types. The table is left empty if there
+/// is no readout metadata available.
+///
+void TRestDetectorSignalToRawSignalProcess::InitParametersTable() {
+    fParametersBySignalID.clear();
+    fTypeBySignalID.clear();
+
+    auto readout = GetMetadata<TRestDetectorReadout>();
+    if (readout == nullptr) {
+        RESTDebug << "TRestDetectorSignalToRawSignalProcess::InitParametersTable: "
+                  << "no readout found, parameters will be resolved from the signal type" << RESTendl;
+        return;
+    }
 
-            Double_t maxTime = std::numeric_limits<Double_t>::min();
-            Double_t minTime = std::numeric_limits<Double_t>::max();
-            for (const auto& signal : tpcSignals) {
-                const auto maxSignalTime = signal->GetMaxTime();
-                if (maxSignalTime > maxTime) {
-                    maxTime = maxSignalTime;
+    for (int planeIndex = 0; planeIndex < readout->GetNumberOfReadoutPlanes(); planeIndex++) {
+        const auto plane = readout->GetReadoutPlane(planeIndex);
+        for (unsigned int moduleIndex = 0; moduleIndex < plane->GetNumberOfModules(); moduleIndex++) {
+            const auto module = plane->GetModule(moduleIndex);
+            for (unsigned int channelIndex = 0; channelIndex < module->GetNumberOfChannels();
+                 channelIndex++) {
+                const auto channel = module->GetChannel(channelIndex);
+                const Int_t daqId = channel->GetDaqID();
+                if (daqId < 0) {
+                    continue;
                 }
-                const auto minSignalTime = signal->GetMinTime();
-                if (minSignalTime < minTime) {
-                    minTime = minSignalTime;
+
+                const string type = channel->GetChannelType();
+                auto parameters = fParametersMap.find(type);
+                if (parameters == fParametersMap.end()) {
+                    RESTWarning << "TRestDetectorSignalToRawSignalProcess::InitParametersTable: "
+                                << "type " << type << " not found in parameters map" << RESTendl;
+                    parameters = fParametersMap.find("");
                 }
 
-                if (minSignalTime < 0) {
-                    RESTWarning << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: EventID: "
-                                << fInputSignalEvent->GetID() << " signal ID: " << signal->GetSignalID()
-                                << " minSignalTime < 0. MinSignalTime: " << minSignalTime << RESTendl;
-                    signal->Print();
-                    return nullptr;
+                if (daqId >= (Int_t)fParametersBySignalID.size()) {
+                    fParametersBySignalID.resize(daqId + 1, nullptr);
+                    fTypeBySignalID.resize(daqId + 1);
                 }
+                fParametersBySignalID[daqId] = &parameters->second;
+                fTypeBySignalID[daqId] = type;
             }
+        }
+    }
+}
 
-            if (minTime > maxTime || minTime < 0) {
-                RESTWarning << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: EventID: "
-                            << fInputSignalEvent->GetID()
-                            << " minTime > maxTime or minTime < 0. MinTime: " << minTime
-                            << " MaxTime: " << maxTime << RESTendl;
-                return nullptr;
-            }
+///////////////////////////////////////////////
+/// \brief It reads the file defined by *channelCalibration* into the dense tables fChannelGains and
+/// fChannelOffsets, indexed by signal ID.
+///
+void TRestDetectorSignalToRawSignalProcess::InitChannelCalibration() {
+    fChannelGains.clear();
+    fChannelOffsets.clear();
+    if (fChannelCalibration.empty()) {
+        return;
+    }
 
-            triggerTime = minTime;
-            bool thresholdReached = false;
-            double maxEnergy = 0;
-            while (triggerTime <= maxTime + fSampling) {
-                // iterate over number of signals
-                double energy = 0;
-                const double startTime = triggerTime - fSampling * fNPoints;
-                for (const auto& signal : tpcSignals) {
-                    energy += signal->GetIntegralWithTime(startTime, triggerTime);
-                }
-                if (energy > maxEnergy) {
-                    maxEnergy = energy;
-                }
-                if (maxEnergy >= fIntegralThresholdTPCkeV) {
-                    thresholdReached = true;
-                    break;
-                }
-                triggerTime += fSampling;
-            }
+    ifstream file(fChannelCalibration);
+    if (!file.is_open()) {
+        RESTError << "TRestDetectorSignalToRawSignalProcess::InitChannelCalibration: "
+                  << "channel calibration file not found: " << fChannelCalibration << RESTendl;
+        exit(1);
+    }
 
-            if (!thresholdReached) {
-                return nullptr;
-            }
+    string line;
+    while (getline(file, line)) {
+        istringstream stream(line);
+        Int_t signalID;
+        Double_t gain;
+        Double_t offset = 0;
+        if (line.empty() || line[0] == '#' || !(stream >> signalID)) {
+            continue;
+        }
+        if (!(stream >> gain) || signalID < 0 || gain <= 0) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::InitChannelCalibration: "
+                      << "invalid line in " << fChannelCalibration << ": " << line << RESTendl;
+            exit(1);
+        }
+        stream >> offset;
 
-            startTimeNoOffset = triggerTime;
+        if (signalID >= (Int_t)fChannelGains.size()) {
+            fChannelGains.resize(signalID + 1, 1.0);
+            fChannelOffsets.resize(signalID + 1, 0.0);
         }
+        fChannelGains[signalID] = gain;
+        fChannelOffsets[signalID] = offset;
+    }
+}
 
-    } else if (fTriggerMode == "fixed") {
-        startTimeNoOffset = fTriggerFixedStartTime;
-    } else {
-        cerr << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-             << "Trigger mode not recognized" << RESTendl;
-        exit(1);
+///////////////////////////////////////////////
+/// \brief It shapes the baseline subtracted binned signal with the method defined by the
+/// *shapingMethod* parameter. In *auto* mode the method is chosen from the signal occupancy.
+/// `occupiedBins` is a scratch buffer used to store the list of positive bins.
+///
+template <typename T>
+void TRestDetectorSignalToRawSignalProcess::ShapeSignal(const T* deposits, T* output,
+                                                        const Parameters& parameters,
+                                                        vector<Int_t>& occupiedBins,
+                                                        vector<complex<Double_t>>& spectrum) const {
+    const vector<T>& kernel = GetKernel(parameters, output);
+
+    if (parameters.shapingModel == "crrc") {
+        ShapeCRRC(deposits, output, fNPoints, parameters.sampling, parameters.shapingTime,
+                  parameters.shapingOrder, parameters.shapingDecayTime);
+        return;
     }
 
-    for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
-        TRestDetectorSignal* signal = fInputSignalEvent->GetSignal(n);
-        Int_t signalID = signal->GetSignalID();
-        string type = signal->GetSignalType();
-        // Check type is in the map
-        if (fParametersMap.find(type) == fParametersMap.end()) {
-            RESTWarning << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-                        << "type " << type << " not found in parameters map" << RESTendl;
-            type = "";
-        }
-
-        double noiseLevel = fParametersMap.at(type).noiseLevel;
-        double sampling = fParametersMap.at(type).sampling;
-        double shapingTime = fParametersMap.at(type).shapingTime;
-        double calibrationGain = fParametersMap.at(type).calibrationGain;
-        double calibrationOffset = fParametersMap.at(type).calibrationOffset;
-
-        double timeStart = startTimeNoOffset - fTriggerDelay * sampling;
-        double timeEnd = timeStart + fNPoints * sampling;
-        RESTDebug << "fTimeStart: " << timeStart << " us " << RESTendl;
-        RESTDebug << "fTimeEnd: " << timeEnd << " us " << RESTendl;
+    if (fShapingMethod == "direct") {
+        ShapeDirect(deposits, output, fNPoints, kernel);
+        return;
+    }
+    if (fShapingMethod == "fft") {
+        ShapeFFT(deposits, output, fNPoints, parameters.shapingKernelSpectrum, spectrum);
+        return;
+    }
 
-        if (timeStart + fTriggerDelay * sampling < 0) {
-            // This means something is wrong (negative times somewhere). This should never happen
-            cerr << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-                 << "fTimeStart < - fTriggerDelay * fSampling" << endl;
-            exit(1);
+    occupiedBins.clear();
+    for (int i = 0; i < fNPoints; i++) {
+        if (deposits[i] > 0) {
+            occupiedBins.push_back(i);
         }
+    }
 
-        // TODO: time offset may not be working correctly
-        // TODO: event drawing not working correctly (some signals are clipped)
+    if (fShapingMethod == "sparse") {
+        ShapeSparse(deposits, occupiedBins, output, fNPoints, kernel);
+        return;
+    }
 
-        if (timeStart + fTriggerDelay * fSampling < 0) {
-            // This means something is wrong (negative times somewhere). This should never happen
-            RESTError << "TRestDetectorSignalToRawSignalProcess::ProcessEvent: "
-                      << "fTimeStart < - fTriggerDelay * fSampling" << RESTendl;
-            exit(1);
-        }
+    // "auto": compare the number of multiply-adds of the convolution against the (approximate) cost of the
+    // forward and inverse transforms. The sparse path pays off while the occupied bins are a small fraction
+    // of the signal, otherwise a sequential sweep over all the bins is cheaper.
+    const double fftSize = parameters.shapingKernelSpectrum.size();
+    const double fftCost = 5.0 * fftSize * log2(fftSize);
+    const double convolutionCost = (double)occupiedBins.size() * kernel.size();
+    if (fftSize > 0 && convolutionCost > fftCost) {
+        ShapeFFT(deposits, output, fNPoints, parameters.shapingKernelSpectrum, spectrum);
+    } else if (4 * occupiedBins.size() < (size_t)fNPoints) {
+        ShapeSparse(deposits, occupiedBins, output, fNPoints, kernel);
+    } else {
+        ShapeDirect(deposits, output, fNPoints, kernel);
+    }
+}
 
-        vector<Double_t> data(fNPoints, calibrationOffset);
+///////////////////////////////////////////////
+/// \brief It adds gaussian noise with standard deviation `noiseLevel` to `data`. The noise samples
+/// are obtained from a counter-based generator, sample `i` only depends on `i` and on `stream`.
+/// Random words are produced in blocks and then transformed with the Box-Muller method.
+///
+void TRestDetectorSignalToRawSignalProcess::AddNoise(Double_t* data, Int_t nPoints, Double_t noiseLevel,
+                                                     const NoiseStream& stream) {
+    AddNoiseKernel(data, nPoints, noiseLevel, stream);
+}
 
-        for (int m = 0; m < signal->GetNumberOfPoints(); m++) {
-            Double_t t = signal->GetTime(m);
-            Double_t d = signal->GetData(m);
+void TRestDetectorSignalToRawSignalProcess::AddNoise(Float_t* data, Int_t nPoints, Double_t noiseLevel,
+                                                     const NoiseStream& stream) {
+    AddNoiseKernel(data, nPoints, noiseLevel, stream);
+}
 
-            if (GetVerboseLevel() >= TRestStringOutput::REST_Verbose_Level::REST_Debug && n < 3 && m < 5) {
-                cout << "Signal: " << n << " Sample: " << m << " T: " << t << " Data: " << d << endl;
-            }
+///////////////////////////////////////////////
+/// \brief It adds to `data` one of the waveforms of `library`, which contains consecutive waveforms of
+/// `waveformLength` samples. The waveform and its starting sample are selected with the counter-based
+/// generator, and the waveform is wrapped around if needed.
+///
+void TRestDetectorSignalToRawSignalProcess::AddLibraryNoise(Double_t* data, Int_t nPoints,
+                                                            const vector<Float_t>& library,
+                                                            Int_t waveformLength, const NoiseStream& stream) {
+    AddLibraryNoiseKernel(data, nPoints, library, waveformLength, stream);
+}
+
+void TRestDetectorSignalToRawSignalProcess::AddLibraryNoise(Float_t* data, Int_t nPoints,
+                                                            const vector<Float_t>& library,
+                                                            Int_t waveformLength, const NoiseStream& stream) {
+    AddLibraryNoiseKernel(data, nPoints, library, waveformLength, stream);
+}
 
-            if (t > timeStart && t < timeEnd) {
-                // convert physical time (in us) to timeBin
-                auto timeBin = (Int_t)round((t - timeStart) / sampling);
+///////////////////////////////////////////////
+/// \brief It returns the measured response defined by the *shapingResponse* parameter resampled for
+/// the given readout type parameters. The file can be a ROOT file, from which the first TGraph found
+/// is used, or a text file with two columns (time in us and amplitude). Resampled responses are cached,
+/// so that each file is only read once by all the process instances.
+///
+vector<Double_t> TRestDetectorSignalToRawSignalProcess::LoadResponseKernel(const Parameters& parameters) {
+    const auto key =
+        make_tuple(parameters.shapingResponse, parameters.sampling, fNPoints, fShapingKernelEpsilon);
+
+    lock_guard<mutex> lock(responseKernelMutex);
+    if (responseKernelCache.count(key) == 0) {
+        const string& fileName = parameters.shapingResponse;
+        if (!TRestTools::fileExists(fileName)) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::LoadResponseKernel: "
+                      << "response file not found: " << fileName << RESTendl;
+            exit(1);
+        }
 
-                if (GetVerboseLevel() >= TRestStringOutput::REST_Verbose_Level::REST_Warning) {
-                    if (timeBin < 0 || timeBin > fNPoints) {
-                        cout << "Time bin out of range!!! bin value: " << timeBin << endl;
-                        timeBin = 0;
+        unique_ptr<TGraph> response;
+        if (TRestTools::isRootFile(fileName)) {
+            unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+            if (file != nullptr && !file->IsZombie()) {
+                for (const auto object : *file->GetListOfKeys()) {
+                    auto fileKey = (TKey*)object;
+                    // the class of an object may be unknown, e.g. if its library is not loaded
+                    const TClass* objectClass = TClass::GetClass(fileKey->GetClassName());
+                    if (objectClass != nullptr && objectClass->InheritsFrom(TGraph::Class())) {
+                        response.reset((TGraph*)fileKey->ReadObj());
+                        break;
                     }
                 }
-
-                RESTDebug << "Adding data: " << signal->GetData(m) << " to Time Bin: " << timeBin << RESTendl;
-                data[timeBin] += calibrationGain * signal->GetData(m);
             }
+        } else {
+            response = make_unique<TGraph>(fileName.c_str());
         }
 
-        // Noise before shaping
-        if (noiseLevel > 0) {
-            for (int i = 0; i < fNPoints; i++) {
-                data[i] += gRandom->Gaus(0, noiseLevel);
-            }
+        vector<Double_t> kernel;
+        if (response != nullptr) {
+            kernel = GetResponseKernel(*response, parameters.sampling, fNPoints, fShapingKernelEpsilon);
+        }
+        if (kernel.empty()) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::LoadResponseKernel: "
+                      << "no valid response found in file: " << fileName << RESTendl;
+            exit(1);
         }
+        responseKernelCache[key] = kernel;
+    }
 
-        if (shapingTime > 0) {
-            const auto sinShaper = [](Double_t t) -> Double_t {
-                if (t <= 0) {
-                    return 0;
-                }
-                // function is normalized such that its absolute maximum is 1.0
-                // max is at x = 1.1664004483744728
-                return TMath::Exp(-3.0 * t) * TMath::Power(t, 3.0) * TMath::Sin(t) * 22.68112123672292;
-            };
-
-            const auto shapingFunction = [&sinShaper](Double_t t) -> Double_t {
-                if (t <= 0) {
-                    return 0;
-                }
-                // function is normalized such that its absolute maximum is 1.0
-                // max is at x = 1.1664004483744728
-                // return sinShaper(t) - 1.0 * sinShaper(t - 1); // to add undershoot
-                return sinShaper(t);
-            };
-
-            vector<Double_t> dataAfterShaping(fNPoints, calibrationOffset);
-            for (int i = 0; i < fNPoints; i++) {
-                const Double_t value = data[i] - calibrationOffset;
-                if (value <= 0) {
-                    // Only positive values are possible, 0 means no signal in this bin
-                    continue;
-                }
-                for (int j = 0; j < fNPoints; j++) {
-                    dataAfterShaping[j] += value * shapingFunction(((j - i) * sampling) / shapingTime);
-                }
-            }
-            data = dataAfterShaping;
+    return responseKernelCache.at(key);
+}
+
+///////////////////////////////////////////////
+/// \brief It fills the noise library, either reading the pedestal run file defined by the
+/// *noiseLibrary* parameter, or generating the waveforms with the default readout type parameters.
+///
+void TRestDetectorSignalToRawSignalProcess::InitNoiseLibrary() {
+    fNoiseLibraryWaveforms = nullptr;
+    fNoiseLibraryLength = 0;
+    if (fNoiseLibrary.empty()) {
+        return;
+    }
 
-            // Noise after shaping
-            if (noiseLevel > 0) {
-                for (int i = 0; i < fNPoints; i++) {
-                    data[i] += gRandom->Gaus(0, noiseLevel);
+    lock_guard<mutex> lock(noiseLibraryMutex);
+
+    if (fNoiseLibrary == "generate") {
+        const auto& parameters = fParametersMap.at("");
+        // the generated waveforms only depend on these parameters
+        ostringstream key;
+        key.precision(17);
+        key << fNoiseLibrary << ":" << fNoiseSeed << ":" << fNoiseLibrarySize << ":" << fNPoints << ":"
+            << parameters.sampling << ":" << parameters.noiseLevel << ":" << parameters.shapingModel << ":"
+            << parameters.shapingTime << ":" << parameters.shapingOrder << ":" << parameters.shapingDecayTime
+            << ":" << parameters.shapingResponse;
+        const string cacheKey = key.str();
+
+        if (noiseLibraryCache.count(cacheKey) == 0) {
+            auto waveforms = make_shared<vector<Float_t>>();
+            waveforms->reserve((size_t)fNoiseLibrarySize * fNPoints);
+
+            vector<Double_t> noise(fNPoints);
+            vector<Double_t> shapedNoise(fNPoints);
+            vector<Int_t> occupiedBins;
+            vector<complex<Double_t>> spectrum;
+            for (int n = 0; n < fNoiseLibrarySize; n++) {
+                NoiseStream stream;
+                stream.seed = fNoiseSeed;
+                stream.signalID = n;
+                stream.stage = 3;
+
+                fill(noise.begin(), noise.end(), 0.0);
+                AddNoise(noise.data(), fNPoints, parameters.noiseLevel, stream);
+                if (parameters.HasShaping()) {
+                    ShapeSignal(noise.data(), shapedNoise.data(), parameters, occupiedBins, spectrum);
+                    noise = shapedNoise;
+                    stream.stage = 4;
+                    AddNoise(noise.data(), fNPoints, parameters.noiseLevel, stream);
                 }
+                waveforms->insert(waveforms->end(), noise.begin(), noise.end());
             }
+            noiseLibraryCache[cacheKey] = {waveforms, fNPoints};
         }
 
-        TRestRawSignal rawSignal;
-        rawSignal.SetSignalID(signalID);
-        for (int x = 0; x < fNPoints; x++) {
-            double value = round(data[x]);
-            if (GetVerboseLevel() >= TRestStringOutput::REST_Verbose_Level::REST_Warning) {
-                if (value < numeric_limits<Short_t>::min() || value > numeric_limits<Short_t>::max()) {
-                    RESTDebug << "value (" << value << ") is outside short range ("
-                              << numeric_limits<Short_t>::min() << ", " << numeric_limits<Short_t>::max()
-                              << ")" << RESTendl;
+        fNoiseLibraryWaveforms = noiseLibraryCache.at(cacheKey).first;
+        fNoiseLibraryLength = noiseLibraryCache.at(cacheKey).second;
+        return;
+    }
+
+    if (noiseLibraryCache.count(fNoiseLibrary) == 0) {
+        TRestRun run(fNoiseLibrary);
+        auto pedestalEvent = dynamic_cast<TRestRawSignalEvent*>(run.GetInputEvent());
+        if (pedestalEvent == nullptr) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::InitNoiseLibrary: "
+                      << "file " << fNoiseLibrary << " does not contain TRestRawSignalEvents" << RESTendl;
+            exit(1);
+        }
+
+        auto waveforms = make_shared<vector<Float_t>>();
+        Int_t length = 0;
+        for (int entry = 0; entry < run.GetEntries(); entry++) {
+            run.GetEntry(entry);
+            for (int n = 0; n < pedestalEvent->GetNumberOfSignals(); n++) {
+                const TRestRawSignal* signal = pedestalEvent->GetSignal(n);
+                if (length == 0) {
+                    length = signal->GetNumberOfPoints();
+                }
+                if (signal->GetNumberOfPoints() != length || length == 0) {
+                    continue;
                 }
-            }
 
-            if (value < numeric_limits<Short_t>::min()) {
-                value = numeric_limits<Short_t>::min();
-                fOutputRawSignalEvent->SetOK(false);
-            } else if (value > numeric_limits<Short_t>::max()) {
-                value = numeric_limits<Short_t>::max();
-                fOutputRawSignalEvent->SetOK(false);
+                Double_t baseLine = 0;
+                for (int p = 0; p < length; p++) {
+                    baseLine += signal->GetRawData(p);
+                }
+                baseLine /= length;
+                for (int p = 0; p < length; p++) {
+                    waveforms->push_back(signal->GetRawData(p) - baseLine);
+                }
             }
-            rawSignal.AddPoint((Short_t)value);
         }
 
-        if (GetVerboseLevel() >= TRestStringOutput::REST_Verbose_Level::REST_Debug) {
-            rawSignal.Print();
+        if (waveforms->empty()) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::InitNoiseLibrary: "
+                      << "no noise waveforms found in file " << fNoiseLibrary << RESTendl;
+            exit(1);
         }
-        RESTDebug << "Adding signal to raw signal event" << RESTendl;
-
-        fOutputRawSignalEvent->AddSignal(rawSignal);
+        waveforms->shrink_to_fit();
+        noiseLibraryCache[fNoiseLibrary] = {waveforms, length};
     }
 
-    SetObservableValue("triggerTimeTPC", triggerTime);
-
-    RESTDebug << "TRestDetectorSignalToRawSignalProcess. Returning event with N signals "
-              << fOutputRawSignalEvent->GetNumberOfSignals() << RESTendl;
-
-    return fOutputRawSignalEvent;
+    fNoiseLibraryWaveforms = noiseLibraryCache.at(fNoiseLibrary).first;
+    fNoiseLibraryLength = noiseLibraryCache.at(fNoiseLibrary).second;
 }
 
 ///////////////////////////////////////////////
@@ -563,6 +2314,42 @@ void TRestDetectorSignalToRawSignalProcess::InitFromConfigFile() {
         parameters.calibrationRange =
             Get2DVectorParameterWithUnits("calibrationRange" + typeCamelCase, parameters.calibrationRange);
         parameters.noiseLevel = GetDblParameterWithUnits("noiseLevel" + typeCamelCase, parameters.noiseLevel);
+        parameters.shapingModel = GetParameter("shapingModel" + typeCamelCase, parameters.shapingModel);
+        parameters.shapingOrder =
+            StringToInteger(GetParameter("shapingOrder" + typeCamelCase, parameters.shapingOrder));
+        parameters.shapingDecayTime =
+            GetDblParameterWithUnits("shapingDecayTime" + typeCamelCase, parameters.shapingDecayTime);
+        parameters.shapingResponse = GetParameter("shapingResponse" + typeCamelCase, "");
+        parameters.earlyRejectionThreshold = GetDblParameterWithUnits(
+            "earlyRejectionThreshold" + typeCamelCase, parameters.earlyRejectionThreshold);
+        parameters.singlePrecision =
+            StringToBool(GetParameter("singlePrecision" + typeCamelCase, parameters.singlePrecision));
+        parameters.zeroSuppressionThreshold = GetDblParameterWithUnits(
+            "zeroSuppressionThreshold" + typeCamelCase, parameters.zeroSuppressionThreshold);
+        parameters.zeroSuppressionPreSamples = StringToInteger(
+            GetParameter("zeroSuppressionPreSamples" + typeCamelCase, parameters.zeroSuppressionPreSamples));
+        parameters.zeroSuppressionPostSamples = StringToInteger(GetParameter(
+            "zeroSuppressionPostSamples" + typeCamelCase, parameters.zeroSuppressionPostSamples));
+        if (!parameters.shapingResponse.empty()) {
+            parameters.shapingModel = "response";
+        }
+
+        if (parameters.shapingModel != "sin" && parameters.shapingModel != "crrc" &&
+            parameters.shapingModel != "response") {
+            RESTError << "Shaping model set to: '" << parameters.shapingModel
+                      << "'. Please use 'sin', 'crrc' or 'response'" << RESTendl;
+            exit(1);
+        }
+        if (parameters.shapingModel == "response" && parameters.shapingResponse.empty()) {
+            RESTError << "The 'response' shaping model requires the 'shapingResponse" << typeCamelCase
+                      << "' parameter" << RESTendl;
+            exit(1);
+        }
+        if (parameters.shapingOrder < 1 || parameters.shapingOrder > maxShapingOrder) {
+            RESTError << "shapingOrder must be between 1 and " << maxShapingOrder << ": "
+                      << parameters.shapingOrder << RESTendl;
+            exit(1);
+        }
 
         const bool isLinearCalibration =
             (parameters.calibrationEnergy.Mod() != 0 && parameters.calibrationRange.Mod() != 0);
@@ -587,8 +2374,7 @@ void TRestDetectorSignalToRawSignalProcess::InitFromConfigFile() {
     fNPoints = StringToInteger(nPoints);
 
     fTriggerMode = GetParameter("triggerMode", fTriggerMode);
-    const set<string> validTriggerModes = {"firstDeposit", "integralThreshold", "fixed",
-                                           "observable",   "firstDepositTPC",   "integralThresholdTPC"};
+    const set<string> validTriggerModes = GetTriggerModes();
     if (validTriggerModes.count(fTriggerMode) == 0) {
         RESTError << "Trigger mode set to: '" << fTriggerMode
                   << "' which is not a valid trigger mode. Please use one of the following trigger modes: ";
@@ -601,6 +2387,17 @@ void TRestDetectorSignalToRawSignalProcess::InitFromConfigFile() {
 
     fTriggerDelay = StringToInteger(GetParameter("triggerDelay", fTriggerDelay));
     fIntegralThreshold = StringToDouble(GetParameter("integralThreshold", fIntegralThreshold));
+    fIntegralThresholdStep = GetDblParameterWithUnits("integralThresholdStep", fIntegralThresholdStep);
+    if (fIntegralThresholdStep <= 0) {
+        RESTError << "integralThresholdStep must be greater than 0: " << fIntegralThresholdStep << RESTendl;
+        exit(1);
+    }
+    fIntegralThresholdCrossing = GetParameter("integralThresholdCrossing", fIntegralThresholdCrossing);
+    if (fIntegralThresholdCrossing != "first" && fIntegralThresholdCrossing != "last") {
+        RESTError << "integralThresholdCrossing set to: '" << fIntegralThresholdCrossing
+                  << "'. Please use 'first' or 'last'" << RESTendl;
+        exit(1);
+    }
     fIntegralThresholdTPCkeV =
         StringToDouble(GetParameter("integralThresholdTPCkeV", fIntegralThresholdTPCkeV));
     if (fIntegralThresholdTPCkeV <= 0) {
@@ -612,6 +2409,36 @@ void TRestDetectorSignalToRawSignalProcess::InitFromConfigFile() {
 
     fTriggerFixedStartTime = GetDblParameterWithUnits("triggerFixedStartTime", fTriggerFixedStartTime);
 
+    fChannelThreads = StringToInteger(GetParameter("channelThreads", fChannelThreads));
+    fTriggerWindows = StringToInteger(GetParameter("triggerWindows", fTriggerWindows));
+    fTriggerWindowIDOffset = StringToInteger(GetParameter("triggerWindowIDOffset", fTriggerWindowIDOffset));
+
+    fStreaming = StringToBool(GetParameter("streaming", fStreaming));
+    fStreamEventSpacing = GetDblParameterWithUnits("streamEventSpacing", fStreamEventSpacing);
+    fStreamDeadTime = GetDblParameterWithUnits("streamDeadTime", fStreamDeadTime);
+    fStreamBufferSize = StringToInteger(GetParameter("streamBufferSize", fStreamBufferSize));
+    fStreamMaxPendingFrames =
+        StringToInteger(GetParameter("streamMaxPendingFrames", fStreamMaxPendingFrames));
+
+    fChannelCalibration = GetParameter("channelCalibration", fChannelCalibration);
+
+    fNoiseSeed = StringToInteger(GetParameter("noiseSeed", fNoiseSeed));
+    fNoiseLibrary = GetParameter("noiseLibrary", fNoiseLibrary);
+    fNoiseLibrarySize = StringToInteger(GetParameter("noiseLibrarySize", fNoiseLibrarySize));
+
+    fShapingKernelEpsilon = StringToDouble(GetParameter("shapingKernelEpsilon", fShapingKernelEpsilon));
+    fShapingMethod = GetParameter("shapingMethod", fShapingMethod);
+    const set<string> validShapingMethods = {"auto", "direct", "sparse", "fft"};
+    if (validShapingMethods.count(fShapingMethod) == 0) {
+        RESTError << "Shaping method set to: '" << fShapingMethod
+                  << "' which is not a valid shaping method. Please use one of the following methods: ";
+        for (const auto& shapingMethod : validShapingMethods) {
+            RESTError << shapingMethod << " ";
+        }
+        RESTError << RESTendl;
+        exit(1);
+    }
+
     // load default parameters (for backward compatibility)
     fSampling = fParametersMap.at(defaultType).sampling;
     fShapingTime = fParametersMap.at(defaultType).shapingTime;
@@ -631,48 +2458,287 @@ void TRestDetectorSignalToRawSignalProcess::InitFromConfigFile() {
     }
 }
 
-void TRestDetectorSignalToRawSignalProcess::InitProcess() {}
+void TRestDetectorSignalToRawSignalProcess::InitProcess() {
+    fStreamDeposits.clear();
+    fStreamTriggers.clear();
+    fStreamScanTime = numeric_limits<Double_t>::lowest();
+    fStreamLastTrigger = numeric_limits<Double_t>::lowest();
+    fStreamEvents = 0;
+    fStreamEndEvent = GetRunInfo() != nullptr ? GetRunInfo()->GetEntries() : 0;
+    fStreamFrames = 0;
+    fStreamDroppedDeposits = 0;
+    fStreamDroppedFrames = 0;
+    fStreamSignalTypes.clear();
+
+    fRunNumber = GetRunInfo() != nullptr ? GetRunInfo()->GetRunNumber() : 0;
+
+    if (fTriggerWindows > 1) {
+        RESTInfo << "TRestDetectorSignalToRawSignalProcess::InitProcess: triggerWindows is "
+                 << fTriggerWindows << ", the signals of the extra windows are written to the output "
+                 << "event with their IDs shifted by multiples of " << fTriggerWindowIDOffset << RESTendl;
+    }
+
+    {
+        lock_guard<mutex> lock(triggerStrategiesMutex);
+        const auto& strategies = GetTriggerStrategies();
+        if (strategies.count(fTriggerMode) == 0) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::InitProcess: "
+                      << "Trigger mode not recognized: " << fTriggerMode << RESTendl;
+            exit(1);
+        }
+        fTriggerStrategy = strategies.at(fTriggerMode);
+    }
+
+    if (fTriggerMode == "firstDepositTPC" || fTriggerMode == "integralThresholdTPC") {
+        fReadout = GetMetadata<TRestDetectorReadout>();
+        if (fReadout == nullptr) {
+            RESTError << "TRestDetectorSignalToRawSignalProcess::InitProcess: "
+                      << "TRestDetectorReadout metadata not found" << RESTendl;
+            exit(1);
+        }
+    }
+
+    for (auto& [type, parameters] : fParametersMap) {
+        parameters.shapingKernel.clear();
+        parameters.shapingKernelSpectrum.clear();
+        parameters.shapingKernelFloat.clear();
+        if (!parameters.HasShaping() || parameters.shapingModel == "crrc") {
+            continue;
+        }
+
+        if (parameters.shapingModel == "response") {
+            parameters.shapingKernel = LoadResponseKernel(parameters);
+        } else {
+            parameters.shapingKernel = GetShapingKernel(parameters.sampling, parameters.shapingTime,
+                                                        fNPoints, fShapingKernelEpsilon);
+        }
+        if (fShapingMethod == "fft" || fShapingMethod == "auto") {
+            parameters.shapingKernelSpectrum = GetShapingKernelSpectrum(parameters.shapingKernel, fNPoints);
+        }
+        if (parameters.singlePrecision) {
+            parameters.shapingKernelFloat.assign(parameters.shapingKernel.begin(),
+                                                 parameters.shapingKernel.end());
+        }
+        parameters.shapingKernelMaximum = 0;
+        for (const auto& value : parameters.shapingKernel) {
+            parameters.shapingKernelMaximum = max(parameters.shapingKernelMaximum, abs(value));
+        }
+
+        RESTDebug << "TRestDetectorSignalToRawSignalProcess::InitProcess: shaping kernel for type '" << type
+                  << "' tabulated with " << parameters.shapingKernel.size() << " bins" << RESTendl;
+    }
+
+    InitParametersTable();
+
+    InitChannelCalibration();
+
+    InitNoiseLibrary();
+}
+
+///////////////////////////////////////////////
+/// \brief In streaming mode, it reports the frames which could not be written: the dropped ones, and the
+/// frames still pending when the run did not reach its last entry, or its number of entries is unknown.
+///
+void TRestDetectorSignalToRawSignalProcess::EndProcess() {
+    StopWorkerPool();
 
-Double_t TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC(Double_t adc, const string& type) const {
-    if (fParametersMap.find(type) == fParametersMap.end()) {
-        RESTWarning << "TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC: "
+    if (!fStreaming) {
+        return;
+    }
+    if (!fStreamTriggers.empty()) {
+        RESTWarning << "TRestDetectorSignalToRawSignalProcess::EndProcess: " << fStreamTriggers.size()
+                    << " stream frames were still pending at the end of the run and have not been written "
+                    << "(first trigger at " << fStreamTriggers.front() << " us), the stream was not flushed "
+                    << "since the last entry of the run was not processed" << RESTendl;
+    }
+    if (fStreamDroppedFrames > 0 || fStreamDroppedDeposits > 0) {
+        RESTWarning << "TRestDetectorSignalToRawSignalProcess::EndProcess: " << fStreamDroppedFrames
+                    << " stream frames and " << fStreamDroppedDeposits << " deposits were dropped. "
+                    << "Consider increasing streamMaxPendingFrames or streamBufferSize" << RESTendl;
+    }
+    RESTInfo << "TRestDetectorSignalToRawSignalProcess::EndProcess: " << fStreamFrames
+             << " stream frames written from " << fStreamEvents << " input events" << RESTendl;
+}
+
+///////////////////////////////////////////////
+/// \brief It returns the parameters of the readout type `type`, to be used as a handle by the array
+/// conversion methods, or nullptr if the type is not defined. The handle is valid until the process
+/// is configured again.
+///
+const TRestDetectorSignalToRawSignalProcess::Parameters*
+TRestDetectorSignalToRawSignalProcess::GetParametersHandle(const string& type) const {
+    const auto parameters = fParametersMap.find(type);
+    if (parameters == fParametersMap.end()) {
+        RESTWarning << "TRestDetectorSignalToRawSignalProcess::GetParametersHandle: "
                     << "type " << type << " not found in parameters map" << RESTendl;
+        return nullptr;
+    }
+    return &parameters->second;
+}
+
+Double_t TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC(Double_t adc, const string& type) const {
+    const Parameters* parameters = GetParametersHandle(type);
+    if (parameters == nullptr) {
         return 0;
     }
-    const auto gain = fParametersMap.at(type).calibrationGain;
-    const auto offset = fParametersMap.at(type).calibrationOffset;
-    return (adc - offset) / gain;
+    Double_t energy;
+    GetEnergyFromADC(*parameters, &adc, &energy, 1);
+    return energy;
 }
 
 Double_t TRestDetectorSignalToRawSignalProcess::GetADCFromEnergy(Double_t energy, const string& type) const {
-    if (fParametersMap.find(type) == fParametersMap.end()) {
-        RESTWarning << "TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC: "
-                    << "type " << type << " not found in parameters map" << RESTendl;
+    const Parameters* parameters = GetParametersHandle(type);
+    if (parameters == nullptr) {
+        return 0;
+    }
+    Double_t adc;
+    GetADCFromEnergy(*parameters, &energy, &adc, 1);
+    return adc;
+}
+
+///////////////////////////////////////////////
+/// \brief Same as GetEnergyFromADC(adc, type), for the channel `signalID`. The gain and offset of the
+/// channel defined in *channelCalibration* are applied on top of the readout type calibration. The
+/// type of the channel seen in the processed events or in the readout is used when known, and `type`
+/// otherwise.
+///
+Double_t TRestDetectorSignalToRawSignalProcess::GetEnergyFromADCForSignal(Int_t signalID, Double_t adc,
+                                                                          const string& type) const {
+    const Parameters* parameters = signalID >= 0 && signalID < (Int_t)fParametersBySignalID.size() &&
+                                           fParametersBySignalID[signalID] != nullptr
+                                       ? fParametersBySignalID[signalID]
+                                       : GetParametersHandle(type);
+    if (parameters == nullptr) {
+        return 0;
+    }
+    Double_t energy;
+    GetEnergyFromADCForSignal(*parameters, signalID, &adc, &energy, 1);
+    return energy;
+}
+
+///////////////////////////////////////////////
+/// \brief Same as GetADCFromEnergy(energy, type), for the channel `signalID`. The gain and offset of
+/// the channel defined in *channelCalibration* are applied on top of the readout type calibration. The
+/// type of the channel seen in the processed events or in the readout is used when known, and `type`
+/// otherwise.
+///
+Double_t TRestDetectorSignalToRawSignalProcess::GetADCFromEnergyForSignal(Int_t signalID, Double_t energy,
+                                                                          const string& type) const {
+    const Parameters* parameters = signalID >= 0 && signalID < (Int_t)fParametersBySignalID.size() &&
+                                           fParametersBySignalID[signalID] != nullptr
+                                       ? fParametersBySignalID[signalID]
+                                       : GetParametersHandle(type);
+    if (parameters == nullptr) {
         return 0;
     }
-    const auto gain = fParametersMap.at(type).calibrationGain;
-    const auto offset = fParametersMap.at(type).calibrationOffset;
-    return energy * gain + offset;
+    Double_t adc;
+    GetADCFromEnergyForSignal(*parameters, signalID, &energy, &adc, 1);
+    return adc;
 }
 
 Double_t TRestDetectorSignalToRawSignalProcess::GetTimeFromBin(Double_t bin, const string& type) const {
-    if (fParametersMap.find(type) == fParametersMap.end()) {
-        RESTWarning << "TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC: "
-                    << "type " << type << " not found in parameters map" << RESTendl;
+    const Parameters* parameters = GetParametersHandle(type);
+    if (parameters == nullptr) {
         return 0;
     }
-    const auto sampling = fParametersMap.at(type).sampling;
-    return (bin - fTriggerDelay) * sampling;
+    Double_t time;
+    GetTimeFromBin(*parameters, &bin, &time, 1);
+    return time;
 }
 
 Double_t TRestDetectorSignalToRawSignalProcess::GetBinFromTime(Double_t time, const string& type) const {
-    if (fParametersMap.find(type) == fParametersMap.end()) {
-        RESTWarning << "TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC: "
-                    << "type " << type << " not found in parameters map" << RESTendl;
+    const Parameters* parameters = GetParametersHandle(type);
+    if (parameters == nullptr) {
         return 0;
     }
-    const auto sampling = fParametersMap.at(type).sampling;
-    return (UShort_t)((time + fTriggerDelay * sampling) / sampling);
+    Double_t bin;
+    GetBinFromTime(*parameters, &time, &bin, 1);
+    return bin;
+}
+
+///////////////////////////////////////////////
+/// \brief It converts the `n` ADC values of `adc` into the energies `energy`, using the calibration of
+/// the readout type handle `parameters` (see GetParametersHandle). The channel calibration is not
+/// applied, see GetEnergyFromADCForSignal.
+///
+void TRestDetectorSignalToRawSignalProcess::GetEnergyFromADC(const Parameters& parameters,
+                                                             const Double_t* adc, Double_t* energy,
+                                                             size_t n) const {
+    const Double_t gain = parameters.calibrationGain;
+    const Double_t offset = parameters.calibrationOffset;
+    for (size_t i = 0; i < n; i++) {
+        energy[i] = (adc[i] - offset) / gain;
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It converts the `n` energies of `energy` into the ADC values `adc`, using the calibration of
+/// the readout type handle `parameters` (see GetParametersHandle). The channel calibration is not
+/// applied, see GetADCFromEnergyForSignal.
+///
+void TRestDetectorSignalToRawSignalProcess::GetADCFromEnergy(const Parameters& parameters,
+                                                             const Double_t* energy, Double_t* adc,
+                                                             size_t n) const {
+    const Double_t gain = parameters.calibrationGain;
+    const Double_t offset = parameters.calibrationOffset;
+    for (size_t i = 0; i < n; i++) {
+        adc[i] = energy[i] * gain + offset;
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It converts the `n` ADC values of `adc` of the channel `signalID` into the energies
+/// `energy`, as the synthesis does: the channel gain and offset multiply and shift the calibration of
+/// the readout type handle `parameters`.
+///
+void TRestDetectorSignalToRawSignalProcess::GetEnergyFromADCForSignal(const Parameters& parameters,
+                                                                      Int_t signalID, const Double_t* adc,
+                                                                      Double_t* energy, size_t n) const {
+    const Double_t gain = parameters.calibrationGain * GetChannelGain(signalID);
+    const Double_t offset = parameters.calibrationOffset + GetChannelOffset(signalID);
+    for (size_t i = 0; i < n; i++) {
+        energy[i] = (adc[i] - offset) / gain;
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It converts the `n` energies of `energy` of the channel `signalID` into the ADC values
+/// `adc`, as the synthesis does: the channel gain and offset multiply and shift the calibration of the
+/// readout type handle `parameters`.
+///
+void TRestDetectorSignalToRawSignalProcess::GetADCFromEnergyForSignal(const Parameters& parameters,
+                                                                      Int_t signalID, const Double_t* energy,
+                                                                      Double_t* adc, size_t n) const {
+    const Double_t gain = parameters.calibrationGain * GetChannelGain(signalID);
+    const Double_t offset = parameters.calibrationOffset + GetChannelOffset(signalID);
+    for (size_t i = 0; i < n; i++) {
+        adc[i] = energy[i] * gain + offset;
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It converts the `n` bins of `bin` into the times `time`, using the sampling of the readout
+/// type handle `parameters` (see GetParametersHandle).
+///
+void TRestDetectorSignalToRawSignalProcess::GetTimeFromBin(const Parameters& parameters, const Double_t* bin,
+                                                           Double_t* time, size_t n) const {
+    const Double_t sampling = parameters.sampling;
+    for (size_t i = 0; i < n; i++) {
+        time[i] = (bin[i] - fTriggerDelay) * sampling;
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It converts the `n` times of `time` into the bins `bin`, truncated to an unsigned 16-bit
+/// integer, using the sampling of the readout type handle `parameters` (see GetParametersHandle).
+///
+void TRestDetectorSignalToRawSignalProcess::GetBinFromTime(const Parameters& parameters, const Double_t* time,
+                                                           Double_t* bin, size_t n) const {
+    const Double_t sampling = parameters.sampling;
+    const Double_t delay = fTriggerDelay * sampling;
+    for (size_t i = 0; i < n; i++) {
+        bin[i] = (UShort_t)((time[i] + delay) / sampling);
+    }
 }
 
 void TRestDetectorSignalToRawSignalProcess::PrintMetadata() {
@@ -681,6 +2747,30 @@ void TRestDetectorSignalToRawSignalProcess::PrintMetadata() {
     RESTMetadata << "Points per channel: " << fNPoints << RESTendl;
     RESTMetadata << "Trigger mode: " << fTriggerMode << RESTendl;
     RESTMetadata << "Trigger delay: " << fTriggerDelay << " units" << RESTendl;
+    if (fTriggerMode == "integralThreshold") {
+        RESTMetadata << "Integral threshold: " << fIntegralThreshold << " (step: " << fIntegralThresholdStep
+                     << " us, crossing: " << fIntegralThresholdCrossing << ")" << RESTendl;
+    }
+    RESTMetadata << "Shaping method: " << fShapingMethod << RESTendl;
+    if (!fChannelCalibration.empty()) {
+        RESTMetadata << "Channel calibration: " << fChannelCalibration << " (" << fChannelGains.size()
+                     << " signal IDs)" << RESTendl;
+    }
+    if (fChannelThreads > 1) {
+        RESTMetadata << "Channel threads: " << fChannelThreads << RESTendl;
+    }
+    if (fTriggerWindows > 1) {
+        RESTMetadata << "Trigger windows: " << fTriggerWindows << " (signal ID offset "
+                     << fTriggerWindowIDOffset << ")" << RESTendl;
+    }
+    if (fStreaming) {
+        RESTMetadata << "Streaming mode (event spacing: " << fStreamEventSpacing
+                     << " us, dead time: " << fStreamDeadTime << " us, buffer size: " << fStreamBufferSize
+                     << ", max pending frames: " << fStreamMaxPendingFrames << ")" << RESTendl;
+    }
+    if (!fNoiseLibrary.empty()) {
+        RESTMetadata << "Noise library: " << fNoiseLibrary << RESTendl;
+    }
 
     for (const auto& readoutType : fReadoutTypes) {
         RESTMetadata << RESTendl;
@@ -691,13 +2781,36 @@ void TRestDetectorSignalToRawSignalProcess::PrintMetadata() {
         RESTMetadata << "Readout type: " << type << RESTendl;
         RESTMetadata << "Sampling time: " << fParametersMap.at(readoutType).sampling * 1000 << " ns"
                      << RESTendl;
-        const double shapingTime = fParametersMap.at(readoutType).shapingTime;
-        if (shapingTime > 0) {
-            RESTMetadata << "Shaping time: " << shapingTime * 1000 << " ns" << RESTendl;
+        const auto& parameters = fParametersMap.at(readoutType);
+        if (parameters.shapingModel == "response") {
+            RESTMetadata << "Shaping response: " << parameters.shapingResponse << " ("
+                         << parameters.shapingKernel.size() << " bins)" << RESTendl;
+        } else if (parameters.shapingTime > 0) {
+            RESTMetadata << "Shaping time: " << parameters.shapingTime * 1000 << " ns" << RESTendl;
+            if (parameters.shapingModel == "crrc") {
+                RESTMetadata << "Shaping model: CR-RC^" << parameters.shapingOrder << RESTendl;
+                if (parameters.shapingDecayTime > 0) {
+                    RESTMetadata << "Shaping decay time: " << parameters.shapingDecayTime * 1000 << " ns"
+                                 << RESTendl;
+                }
+            } else {
+                RESTMetadata << "Shaping kernel bins: " << parameters.shapingKernel.size() << RESTendl;
+            }
+        }
+        if (parameters.singlePrecision) {
+            RESTMetadata << "Single precision synthesis" << RESTendl;
+        }
+        if (parameters.earlyRejectionThreshold > 0) {
+            RESTMetadata << "Early rejection threshold: " << parameters.earlyRejectionThreshold << RESTendl;
+        }
+        if (parameters.zeroSuppressionThreshold > 0) {
+            RESTMetadata << "Zero suppression threshold: " << parameters.zeroSuppressionThreshold
+                         << " (pre samples: " << parameters.zeroSuppressionPreSamples
+                         << ", post samples: " << parameters.zeroSuppressionPostSamples << ")" << RESTendl;
         }
         const double noiseLevel = fParametersMap.at(readoutType).noiseLevel;
         if (noiseLevel > 0) {
-            RESTMetadata << "Noise Level: " << noiseLevel << RESTendl;
+            RESTMetadata << "Noise Level: " << noiseLevel << " (seed: " << fNoiseSeed << ")" << RESTendl;
         }
 
         if (IsLinearCalibration()) {
@@ -55,11 +55,42 @@
 /// * **signalThreshold**: The number of sigmas a set of consecutive points
 /// identified over threshold must be over the baseline fluctuations to be
 /// finally considered a physical signal.
+/// * **pedestalRun**: A pedestal run file (TRestRawSignalEvents). If defined, the zero
+/// suppression uses the mean and the standard deviation of all the samples of each
+/// channel in this run as fixed baseline and baseline fluctuation, instead of
+/// calculating them from *baseLineRange* in each event. The channels which are
+/// not found in the pedestal run still use *baseLineRange*.
+/// * **pedestalUpdateFactor**: If set (> 0), the pedestal mean of each channel is
+/// updated after each event, moving it by this fraction towards the mean of the
+/// samples within *pointThreshold* sigmas of the pedestal, to follow the baseline
+/// drifts. The pedestal sigma is not updated. Default is 0. The updated pedestals
+/// are kept by each process instance, starting from the pedestal run values, so
+/// when running with several threads each thread follows the drifts with the
+/// events it processes, and the result depends on the order of the events.
+/// * **nPointsFlatThreshold**: A set of consecutive points over threshold is
+/// ended after this number of points whose value changes by less than the point
+/// threshold, so that saturated or flat signals are not fully accepted. Default is 512.
+///
+/// * **pulseMode**: If true, each pulse (set of consecutive points over
+/// threshold, with or without zero suppression) is transferred as a single point,
+/// instead of one point per sample. It reduces the size of the output events by
+/// one or two orders of magnitude.
+/// * **pulseTime**: The time of each pulse point in *pulseMode*. It can be *peak*
+/// (default), the time of the maximum sample, or *constantFraction*, the time at
+/// which the leading edge crosses *constantFraction* (default 0.5) times the
+/// pulse amplitude, interpolated between samples.
+/// * **pulseAmplitude**: The value of each pulse point in *pulseMode*. It can be
+/// *amplitude* (default), the maximum baseline subtracted sample, or *integral*,
+/// the sum of the baseline subtracted samples of the pulse. It is multiplied by
+/// *gain*.
 ///
 /// List of observables:
 ///
 /// * NSignalsRejected: Number of rejected signals inside a event, due to
 /// zero suppression or just because it is below the desired threshold.
+/// * NPulses: Number of pulses found inside the event, in *pulseMode*.
+/// * PulseWidth: Mean width of the pulses found inside the event, in time
+/// units, in *pulseMode*.
 ///
 /// The following lines of code show how the process metadata should be
 /// defined.
@@ -121,15 +152,50 @@
 
 #include "TRestRawToDetectorSignalProcess.h"
 
+#include <TRestRun.h>
+
+#include <limits>
+#include <mutex>
+
 using namespace std;
 
 ClassImp(TRestRawToDetectorSignalProcess);
 
+namespace {
+mutex pedestalsMutex;
+/// Pedestal mean and sigma tables, indexed by signal ID, for each pedestal run file
+map<string, pair<vector<Double_t>, vector<Double_t>>> pedestalsCache;
+
+/// It returns the minimum integer sample which is over `threshold` once `baseLine` is subtracted. Since
+/// sample - baseLine is monotonic in sample, comparing the samples with it gives exactly the same result
+/// as comparing their baseline subtracted values with `threshold`.
+Double_t GetSampleCut(Double_t baseLine, Double_t threshold) {
+    Double_t cut = floor(baseLine + threshold);
+    while (cut - baseLine > threshold) {
+        cut--;
+    }
+    while (cut - baseLine <= threshold) {
+        cut++;
+    }
+    return cut;
+}
+}  // namespace
+
 ///////////////////////////////////////////////
 /// \brief Default constructor
 ///
 TRestRawToDetectorSignalProcess::TRestRawToDetectorSignalProcess() { Initialize(); }
 
+///////////////////////////////////////////////
+/// \brief Constructor loading data from a config file
+///
+/// \param configFilename A const char* giving the path to an RML file.
+///
+TRestRawToDetectorSignalProcess::TRestRawToDetectorSignalProcess(const char* configFilename) {
+    Initialize();
+    LoadConfigFromFile(configFilename);
+}
+
 ///////////////////////////////////////////////
 /// \brief Default destructor
 ///
@@ -154,27 +220,32 @@ TRestEvent* TRestRawToDetectorSignalProcess::ProcessEvent(TRestEvent* inputEvent
     fInputSignalEvent = (TRestRawSignalEvent*)inputEvent;
 
     Int_t rejectedSignal = 0;
-
-    if (fZeroSuppression) {
-        fInputSignalEvent->SetBaseLineRange(fBaseLineRange);
-        fInputSignalEvent->SetRange(fIntegralRange);
-    }
+    Int_t pulses = 0;
+    Double_t pulseWidth = 0;
 
     for (int n = 0; n < fInputSignalEvent->GetNumberOfSignals(); n++) {
         TRestDetectorSignal signal;
         TRestRawSignal* rawSignal = fInputSignalEvent->GetSignal(n);
         signal.SetID(rawSignal->GetID());
 
+        Double_t baseLine;
         if (fZeroSuppression) {
-            ZeroSuppresion(rawSignal, signal);
+            baseLine = ZeroSuppresion(rawSignal, signal);
         } else {
-            for (int p = 0; p < int(rawSignal->GetNumberOfPoints()); p++) {
-                if (rawSignal->GetData(p) > fThreshold) {
-                    signal.NewPoint(fTriggerStarts + fSampling * p, fGain * rawSignal->GetData(p));
+            ReadSamples(rawSignal);
+            baseLine = rawSignal->GetBaseLine();
+            FindPointsAboveThreshold(fSamples.data(), fSamples.size(), baseLine, fPointsOverThreshold);
+            if (!fPulseMode) {
+                for (const auto p : fPointsOverThreshold) {
+                    signal.NewPoint(fTriggerStarts + fSampling * p, fGain * (fSamples[p] - baseLine));
                 }
             }
         }
 
+        if (fPulseMode) {
+            pulses += AddPulses(signal, baseLine, pulseWidth);
+        }
+
         if (signal.GetNumberOfPoints() > 0) {
             fOutputSignalEvent->AddSignal(signal);
         } else {
@@ -183,6 +254,12 @@ TRestEvent* TRestRawToDetectorSignalProcess::ProcessEvent(TRestEvent* inputEvent
     }
 
     SetObservableValue("NSignalsRejected", rejectedSignal);
+    if (fPulseMode) {
+        fNPulses = pulses;
+        fMeanPulseWidth = pulses > 0 ? pulseWidth / pulses : 0.0;
+        SetObservableValue("NPulses", fNPulses);
+        SetObservableValue("PulseWidth", fMeanPulseWidth);
+    }
 
     if (fOutputSignalEvent->GetNumberOfSignals() <= 0) {
         return nullptr;
@@ -191,13 +268,343 @@ TRestEvent* TRestRawToDetectorSignalProcess::ProcessEvent(TRestEvent* inputEvent
     return fOutputSignalEvent;
 }
 
-void TRestRawToDetectorSignalProcess::ZeroSuppresion(TRestRawSignal* rawSignal, TRestDetectorSignal& signal) {
-    rawSignal->InitializePointsOverThreshold(TVector2(fPointThreshold, fSignalThreshold),
-                                             fNPointsOverThreshold, 512);
+///////////////////////////////////////////////
+/// \brief It identifies the points over threshold of `rawSignal` with FindPointsOverThreshold, and
+/// returns the baseline used. Unless *pulseMode* is enabled, the points are added to `signal` with
+/// their baseline subtracted values.
+///
+Double_t TRestRawToDetectorSignalProcess::ZeroSuppresion(TRestRawSignal* rawSignal,
+                                                         TRestDetectorSignal& signal) {
+    ReadSamples(rawSignal);
+    const Int_t nPoints = fSamples.size();
+
+    const Int_t signalID = rawSignal->GetID();
+    const bool hasPedestal = signalID >= 0 && signalID < (Int_t)fPedestalSigma.size() &&
+                             fPedestalSigma[signalID] >= 0;
+
+    Double_t baseLine;
+    Double_t baseLineSigma;
+    if (hasPedestal) {
+        baseLine = fPedestalMean[signalID];
+        baseLineSigma = fPedestalSigma[signalID];
+    } else {
+        CalculateBaseLine(fSamples.data(), nPoints, baseLine, baseLineSigma);
+    }
+    FindPointsOverThreshold(fSamples.data(), nPoints, baseLine, baseLineSigma, fPointsOverThreshold);
+
+    if (!fPulseMode) {
+        for (const auto j : fPointsOverThreshold) {
+            signal.NewPoint(fTriggerStarts + fSampling * j, fGain * (fSamples[j] - baseLine));
+        }
+    }
+
+    if (hasPedestal && fPedestalUpdateFactor > 0) {
+        // only the samples compatible with the pedestal are used, so that the pulses do not bias it
+        const Double_t band = fPointThreshold * baseLineSigma;
+        Long64_t sum = 0;
+        Int_t count = 0;
+        for (int p = 0; p < nPoints; p++) {
+            const bool inside = abs(fSamples[p] - baseLine) <= band;
+            sum += inside ? fSamples[p] : 0;
+            count += inside;
+        }
+        if (count > 0) {
+            fPedestalMean[signalID] += fPedestalUpdateFactor * ((Double_t)sum / count - baseLine);
+        }
+    }
+
+    return baseLine;
+}
+
+///////////////////////////////////////////////
+/// \brief It adds to `signal` one point per pulse, a pulse being a set of consecutive points inside
+/// fPointsOverThreshold. The point time is the pulse peak time, or the time at which the leading edge
+/// crosses *constantFraction* times the peak amplitude (linearly interpolated between samples). The
+/// point value is the peak amplitude or the pulse integral, baseline subtracted. It returns the number
+/// of pulses, and adds their widths to `pulseWidth`.
+///
+Int_t TRestRawToDetectorSignalProcess::AddPulses(TRestDetectorSignal& signal, Double_t baseLine,
+                                                 Double_t& pulseWidth) const {
+    const auto& points = fPointsOverThreshold;
+    Int_t pulses = 0;
+    for (size_t begin = 0; begin < points.size();) {
+        size_t end = begin + 1;
+        while (end < points.size() && points[end] == points[end - 1] + 1) {
+            end++;
+        }
+
+        Int_t peak = points[begin];
+        Double_t integral = 0;
+        for (size_t n = begin; n < end; n++) {
+            const Int_t p = points[n];
+            integral += fSamples[p] - baseLine;
+            if (fSamples[p] > fSamples[peak]) {
+                peak = p;
+            }
+        }
+        const Double_t amplitude = fSamples[peak] - baseLine;
+
+        Double_t time = peak;
+        if (fPulseTimeConstantFraction) {
+            const Double_t level = fConstantFraction * amplitude;
+            Int_t p = peak;
+            while (p > 0 && fSamples[p - 1] - baseLine >= level) {
+                p--;
+            }
+            time = p;
+            if (p > 0) {
+                const Double_t before = fSamples[p - 1] - baseLine;
+                const Double_t after = fSamples[p] - baseLine;
+                time = p - 1 + (level - before) / (after - before);
+            }
+        }
+
+        signal.NewPoint(fTriggerStarts + fSampling * time,
+                        fGain * (fPulseValueIntegral ? integral : amplitude));
+        pulseWidth += fSampling * (end - begin);
+        pulses++;
+
+        begin = end;
+    }
+    return pulses;
+}
+
+///////////////////////////////////////////////
+/// \brief It calculates the mean and the standard deviation of the raw signal `samples` inside
+/// *baseLineRange*, with the same result as TRestRawSignal::CalculateBaseLine.
+///
+void TRestRawToDetectorSignalProcess::CalculateBaseLine(const Short_t* samples, Int_t nPoints,
+                                                        Double_t& baseLine, Double_t& baseLineSigma) const {
+    const Int_t baseLineStart = max(0, (Int_t)fBaseLineRange.X());
+    const Int_t baseLineEnd = min(nPoints, (Int_t)fBaseLineRange.Y());
+    baseLine = 0;
+    baseLineSigma = 0;
+    if (baseLineEnd > baseLineStart) {
+        // the sum of integers is exact, so it does not depend on the summation order
+        Long64_t sum = 0;
+        for (int p = baseLineStart; p < baseLineEnd; p++) {
+            sum += samples[p];
+        }
+        baseLine = (Double_t)sum / (baseLineEnd - baseLineStart);
+
+        Double_t sigma = 0;
+        for (int p = baseLineStart; p < baseLineEnd; p++) {
+            sigma += (baseLine - samples[p]) * (baseLine - samples[p]);
+        }
+        baseLineSigma = sqrt(sigma / (baseLineEnd - baseLineStart));
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It finds the points over threshold of the raw signal `samples`, given its baseline and
+/// baseline fluctuation. Using CalculateBaseLine values, the result is the same as
+/// TRestRawSignal::InitializePointsOverThreshold.
+///
+/// The samples inside *integralRange* are scanned once. Since the samples are integers, the point
+/// threshold is converted to an integer cut, and the blocks of samples without any sample over it are
+/// skipped with a branchless comparison that the compiler can vectorize.
+///
+void TRestRawToDetectorSignalProcess::FindPointsOverThreshold(const Short_t* samples, Int_t nPoints,
+                                                              Double_t baseLine, Double_t baseLineSigma,
+                                                              vector<Int_t>& points) const {
+    points.clear();
+
+    Int_t start = fIntegralRange.X() < 0 ? 0 : (Int_t)fIntegralRange.X();
+    Int_t end = fIntegralRange.Y();
+    if (end <= 0 || end > nPoints) {
+        end = nPoints;
+    }
+
+    const Double_t threshold = fPointThreshold * baseLineSigma;
+    const Double_t cut = GetSampleCut(baseLine, threshold);
+    if (cut > numeric_limits<Short_t>::max()) {
+        return;
+    }
+    const Short_t minimum = max(cut, (Double_t)numeric_limits<Short_t>::min());
+
+    constexpr int blockSize = 16;
+    for (int i = start; i < end; i++) {
+        if (i % blockSize == 0 && i + blockSize <= end) {
+            Int_t over = 0;
+            for (int k = i; k < i + blockSize; k++) {
+                over |= samples[k] >= minimum;
+            }
+            if (!over) {
+                i += blockSize - 1;
+                continue;
+            }
+        }
+        if (samples[i] < minimum) {
+            continue;
+        }
+
+        // a set of consecutive points over threshold, ended by a flat region of nPointsFlatThreshold
+        const int pulseStart = i;
+        Double_t value = samples[i] - baseLine;
+        Double_t sum = value;
+        Double_t squares = value * value;
+        i++;
+
+        int flatPoints = 0;
+        while (i < end && samples[i] >= minimum) {
+            const Double_t previous = value;
+            value = samples[i] - baseLine;
+            if (abs(value - previous) > threshold) {
+                flatPoints = 0;
+            } else {
+                flatPoints++;
+            }
+
+            if (flatPoints >= fNPointsFlatThreshold) {
+                break;
+            }
+            sum += value;
+            squares += value * value;
+            i++;
+        }
+
+        const int pulseSize = i - pulseStart;
+        if (pulseSize >= fNPointsOverThreshold) {
+            const Double_t mean = sum / pulseSize;
+            const Double_t stdDev = sqrt(squares / pulseSize - mean * mean);
+            if (stdDev > fSignalThreshold * baseLineSigma) {
+                for (int j = pulseStart; j < i; j++) {
+                    points.push_back(j);
+                }
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It copies the samples of `rawSignal` to the fSamples buffer.
+///
+void TRestRawToDetectorSignalProcess::ReadSamples(TRestRawSignal* rawSignal) {
+    const Int_t nPoints = rawSignal->GetNumberOfPoints();
+    fSamples.resize(nPoints);
+    for (int p = 0; p < nPoints; p++) {
+        fSamples[p] = (Short_t)rawSignal->GetRawData(p);
+    }
+}
+
+///////////////////////////////////////////////
+/// \brief It fills `points` with the samples whose value minus `baseLine` is over *threshold*. The
+/// threshold is converted to an integer cut on the samples, and the indices are written without
+/// branches, advancing the output position only for the selected samples.
+///
+void TRestRawToDetectorSignalProcess::FindPointsAboveThreshold(const Short_t* samples, Int_t nPoints,
+                                                               Double_t baseLine,
+                                                               vector<Int_t>& points) const {
+    const Double_t cut = GetSampleCut(baseLine, fThreshold);
+    points.resize(nPoints);
+    if (cut > numeric_limits<Short_t>::max()) {
+        points.clear();
+        return;
+    }
+    const Short_t minimum = max(cut, (Double_t)numeric_limits<Short_t>::min());
 
-    std::vector<Int_t> pOver = rawSignal->GetPointsOverThreshold();
-    for (unsigned int n = 0; n < pOver.size(); n++) {
-        int j = pOver[n];
-        signal.NewPoint(fTriggerStarts + fSampling * j, fGain * rawSignal->GetData(j));
+    Int_t* output = points.data();
+    Int_t count = 0;
+    for (int p = 0; p < nPoints; p++) {
+        output[count] = p;
+        count += samples[p] >= minimum;
     }
+    points.resize(count);
+}
+
+///////////////////////////////////////////////
+/// \brief Process initialization. It validates and decodes the pulse mode parameters and loads the
+/// pedestal table if *pedestalRun* is defined.
+///
+void TRestRawToDetectorSignalProcess::InitProcess() {
+    fPulseTimeConstantFraction = fPulseTime == "constantFraction";
+    fPulseValueIntegral = fPulseAmplitude == "integral";
+    if (fPulseMode) {
+        if (fPulseTime != "peak" && fPulseTime != "constantFraction") {
+            RESTError << "TRestRawToDetectorSignalProcess::InitProcess: pulseTime set to '" << fPulseTime
+                      << "'. Please use 'peak' or 'constantFraction'" << RESTendl;
+            exit(1);
+        }
+        if (fPulseAmplitude != "amplitude" && fPulseAmplitude != "integral") {
+            RESTError << "TRestRawToDetectorSignalProcess::InitProcess: pulseAmplitude set to '"
+                      << fPulseAmplitude << "'. Please use 'amplitude' or 'integral'" << RESTendl;
+            exit(1);
+        }
+    }
+
+    InitPedestals();
+}
+
+///////////////////////////////////////////////
+/// \brief It fills fPedestalMean and fPedestalSigma, indexed by signal ID, with the mean and the
+/// standard deviation of all the samples of each signal inside the *pedestalRun* file. The signals
+/// which are not found get a negative sigma. Pedestal tables are cached, so that each file is only
+/// read once by all the process instances, and each instance updates its own copy.
+///
+void TRestRawToDetectorSignalProcess::InitPedestals() {
+    fPedestalMean.clear();
+    fPedestalSigma.clear();
+    if (fPedestalRun.empty()) {
+        return;
+    }
+
+    lock_guard<mutex> lock(pedestalsMutex);
+
+    if (pedestalsCache.count(fPedestalRun) == 0) {
+        TRestRun run(fPedestalRun);
+        auto pedestalEvent = dynamic_cast<TRestRawSignalEvent*>(run.GetInputEvent());
+        if (pedestalEvent == nullptr) {
+            RESTError << "TRestRawToDetectorSignalProcess::InitPedestals: "
+                      << "file " << fPedestalRun << " does not contain TRestRawSignalEvents" << RESTendl;
+            exit(1);
+        }
+
+        // the sums of integers are exact
+        vector<Long64_t> sums;
+        vector<Long64_t> squares;
+        vector<Long64_t> counts;
+        for (int entry = 0; entry < run.GetEntries(); entry++) {
+            run.GetEntry(entry);
+            for (int n = 0; n < pedestalEvent->GetNumberOfSignals(); n++) {
+                const TRestRawSignal* signal = pedestalEvent->GetSignal(n);
+                const Int_t signalID = signal->GetID();
+                if (signalID < 0) {
+                    continue;
+                }
+                if (signalID >= (Int_t)sums.size()) {
+                    sums.resize(signalID + 1, 0);
+                    squares.resize(signalID + 1, 0);
+                    counts.resize(signalID + 1, 0);
+                }
+                for (int p = 0; p < signal->GetNumberOfPoints(); p++) {
+                    const auto sample = (Long64_t)signal->GetRawData(p);
+                    sums[signalID] += sample;
+                    squares[signalID] += sample * sample;
+                }
+                counts[signalID] += signal->GetNumberOfPoints();
+            }
+        }
+
+        auto& pedestals = pedestalsCache[fPedestalRun];
+        pedestals.first.assign(sums.size(), 0.0);
+        pedestals.second.assign(sums.size(), -1.0);
+        for (size_t signalID = 0; signalID < sums.size(); signalID++) {
+            if (counts[signalID] == 0) {
+                continue;
+            }
+            const Double_t mean = (Double_t)sums[signalID] / counts[signalID];
+            pedestals.first[signalID] = mean;
+            pedestals.second[signalID] =
+                sqrt(max(0.0, (Double_t)squares[signalID] / counts[signalID] - mean * mean));
+        }
+
+        if (sums.empty()) {
+            RESTWarning << "TRestRawToDetectorSignalProcess::InitPedestals: "
+                        << "no signals found in file " << fPedestalRun << RESTendl;
+        }
+    }
+
+    // each instance gets its own copy, since the pedestals may be updated
+    fPedestalMean = pedestalsCache.at(fPedestalRun).first;
+    fPedestalSigma = pedestalsCache.at(fPedestalRun).second;
 }
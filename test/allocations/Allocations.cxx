@@ -0,0 +1,154 @@
+
+#include <TRestDetectorSignalToRawSignalProcess.h>
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+using namespace std;
+
+// These tests replace the global operator new to count the allocations, so they are built in their own
+// executable.
+
+namespace {
+bool countAllocations = false;
+size_t allocations = 0;
+}  // namespace
+
+void* operator new(size_t size) {
+    if (countAllocations) {
+        allocations++;
+    }
+    void* pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+
+void operator delete[](void* pointer) noexcept { free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+
+TEST(TRestDetectorSignalToRawSignalProcess, SynthesisAllocations) {
+    TRestDetectorSignalToRawSignalProcess process;
+    const Int_t nPoints = process.GetNPoints();
+
+    TRestDetectorSignalToRawSignalProcess::Parameters parameters;
+    parameters.sampling = 0.1;
+    parameters.shapingTime = 0.5;
+    parameters.noiseLevel = 5.0;
+    parameters.calibrationOffset = 250;
+    parameters.shapingKernel = TRestDetectorSignalToRawSignalProcess::GetShapingKernel(
+        parameters.sampling, parameters.shapingTime, nPoints, 1E-9);
+    parameters.shapingKernelSpectrum =
+        TRestDetectorSignalToRawSignalProcess::GetShapingKernelSpectrum(parameters.shapingKernel, nPoints);
+
+    // a sparse and a dense signal, so that the different shaping methods are used
+    TRestDetectorSignal sparseSignal;
+    sparseSignal.SetID(1);
+    sparseSignal.NewPoint(12.0, 5.0);
+    sparseSignal.NewPoint(15.3, 2.0);
+
+    TRestDetectorSignal denseSignal;
+    denseSignal.SetID(2);
+    for (int i = 0; i < nPoints; i++) {
+        denseSignal.NewPoint(i * parameters.sampling, 0.1 + (i % 7));
+    }
+
+    TRestDetectorSignalToRawSignalProcess::NoiseStream stream;
+    TRestDetectorSignalToRawSignalProcess::SynthesisBuffers buffers;
+    vector<Short_t> output(nPoints);
+
+    const Double_t startTime = process.GetTriggerDelay() * parameters.sampling;
+    // the first calls grow the scratch buffers
+    process.SynthesizeSignal(&sparseSignal, parameters, startTime, stream, buffers, output.data());
+    process.SynthesizeSignal(&denseSignal, parameters, startTime, stream, buffers, output.data());
+
+    allocations = 0;
+    countAllocations = true;
+    for (int event = 0; event < 10; event++) {
+        stream.eventID = event;
+        process.SynthesizeSignal(&sparseSignal, parameters, startTime, stream, buffers, output.data());
+        process.SynthesizeSignal(&denseSignal, parameters, startTime, stream, buffers, output.data());
+    }
+    countAllocations = false;
+
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_TRUE(*max_element(output.begin(), output.end()) > parameters.calibrationOffset);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, DepositIndexAllocations) {
+    TRestDetectorSignal signal;
+    for (int i = 0; i < 100; i++) {
+        signal.NewPoint((i * 37) % 100, 1.0);
+    }
+    const vector<const TRestDetectorSignal*> signals = {&signal};
+
+    // the first call grows the arrays of the index
+    TRestDetectorSignalToRawSignalProcess::DepositIndex deposits;
+    TRestDetectorSignalToRawSignalProcess::BuildDepositIndex(signals, deposits);
+
+    allocations = 0;
+    countAllocations = true;
+    for (int event = 0; event < 10; event++) {
+        TRestDetectorSignalToRawSignalProcess::BuildDepositIndex(signals, deposits);
+    }
+    countAllocations = false;
+
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_TRUE(is_sorted(deposits.times.begin(), deposits.times.end()));
+    EXPECT_EQ(deposits.cumulativeEnergy.back(), 100.0);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ProcessEventAllocations) {
+    const string configFile = "signalToRawSignalAllocations.rml";
+    ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"allocations\">\n"
+                         << "    <parameter name=\"sampling\" value=\"0.1us\"/>\n"
+                         << "    <parameter name=\"shapingTime\" value=\"0.5us\"/>\n"
+                         << "    <parameter name=\"noiseLevel\" value=\"5\"/>\n"
+                         << "    <parameter name=\"zeroSuppressionThreshold\" value=\"100\"/>\n"
+                         << "</TRestDetectorSignalToRawSignalProcess>\n";
+    TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+    process.InitProcess();
+
+    // the odd signals are below the zero suppression threshold
+    TRestDetectorSignalEvent event;
+    for (int n = 0; n < 20; n++) {
+        TRestDetectorSignal signal;
+        signal.SetID(n);
+        for (int i = 0; i < 5; i++) {
+            signal.NewPoint(10 + 0.3 * i + 0.1 * n, n % 2 == 0 ? 5.0 : 0.01);
+        }
+        event.AddSignal(signal);
+    }
+
+    // the first events grow the buffers and the output signals
+    for (int n = 0; n < 2; n++) {
+        event.SetID(n);
+        ASSERT_TRUE(process.ProcessEvent(&event) != nullptr);
+    }
+
+    TRestRawSignalEvent* output = nullptr;
+    allocations = 0;
+    countAllocations = true;
+    for (int n = 2; n < 12; n++) {
+        event.SetID(n);
+        output = (TRestRawSignalEvent*)process.ProcessEvent(&event);
+    }
+    countAllocations = false;
+
+    EXPECT_EQ(allocations, 0u);
+    ASSERT_TRUE(output != nullptr);
+    EXPECT_EQ(output->GetID(), 11);
+    EXPECT_EQ(output->GetNumberOfSignals(), 10);
+    for (int k = 0; k < output->GetNumberOfSignals(); k++) {
+        EXPECT_EQ(output->GetSignal(k)->GetSignalID(), 2 * k);
+        EXPECT_EQ(output->GetSignal(k)->GetNumberOfPoints(), process.GetNPoints());
+    }
+}
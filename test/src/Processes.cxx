@@ -1,7 +1,12 @@
 
 #include <TRestDetectorSignalToRawSignalProcess.h>
+#include <TRestRawToDetectorSignalProcess.h>
+#include <TRestRun.h>
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <random>
+
 using namespace std;
 
 TEST(TRestDetectorSignalToRawSignalProcess, Default) {
@@ -13,6 +18,980 @@ TEST(TRestDetectorSignalToRawSignalProcess, Default) {
     EXPECT_TRUE(process.GetTriggerDelay() == 100);
     EXPECT_TRUE(process.GetGain() == 100.0);
     EXPECT_TRUE(process.GetIntegralThreshold() == 1229.0);
+    EXPECT_TRUE(process.GetShapingMethod() == "auto");
 
     process.PrintMetadata();
 }
+
+TEST(TRestDetectorSignalToRawSignalProcess, ShapingFFT) {
+    const Int_t nPoints = 512;
+    const Double_t sampling = 0.04;
+    const Double_t shapingTime = 0.5;
+
+    vector<Double_t> deposits(nPoints, 0.0);
+    for (int i = 0; i < nPoints; i++) {
+        deposits[i] = (i % 37 == 0) ? 1000.0 + 10.0 * i : -1.0;
+    }
+
+    const auto kernel =
+        TRestDetectorSignalToRawSignalProcess::GetShapingKernel(sampling, shapingTime, nPoints, 1E-9);
+    EXPECT_TRUE(kernel.size() > 1 && kernel.size() < (size_t)nPoints);
+
+    vector<Double_t> direct(nPoints);
+    TRestDetectorSignalToRawSignalProcess::ShapeDirect(deposits.data(), direct.data(), nPoints, kernel);
+
+    vector<Int_t> occupiedBins;
+    for (int i = 0; i < nPoints; i++) {
+        if (deposits[i] > 0) {
+            occupiedBins.push_back(i);
+        }
+    }
+    vector<Double_t> sparse(nPoints);
+    TRestDetectorSignalToRawSignalProcess::ShapeSparse(deposits.data(), occupiedBins, sparse.data(), nPoints,
+                                                       kernel);
+    EXPECT_TRUE(sparse == direct);
+
+    const auto spectrum = TRestDetectorSignalToRawSignalProcess::GetShapingKernelSpectrum(kernel, nPoints);
+    vector<Double_t> fft(nPoints);
+    TRestDetectorSignalToRawSignalProcess::ShapeFFT(deposits.data(), fft.data(), nPoints, spectrum);
+
+    Double_t maxAmplitude = 0;
+    for (const auto& value : direct) {
+        maxAmplitude = max(maxAmplitude, abs(value));
+    }
+    EXPECT_TRUE(maxAmplitude > 0);
+    for (int i = 0; i < nPoints; i++) {
+        EXPECT_NEAR(direct[i], fft[i], 1E-9 * maxAmplitude);
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ShapingResponse) {
+    const Int_t nPoints = 512;
+    const Double_t sampling = 0.04;
+    const Double_t shapingTime = 0.5;
+
+    // a "measured" response with an arbitrary amplitude, sampled 4 times finer than the signal
+    TGraph response;
+    for (int i = 0; i < 4 * nPoints; i++) {
+        const Double_t t = i * sampling / 4;
+        const Double_t amplitude = TRestDetectorSignalToRawSignalProcess::ShapingFunction(t / shapingTime);
+        response.SetPoint(i, t, 25.0 * amplitude);
+    }
+
+    const auto kernel =
+        TRestDetectorSignalToRawSignalProcess::GetResponseKernel(response, sampling, nPoints, 1E-9);
+    const auto expected =
+        TRestDetectorSignalToRawSignalProcess::GetShapingKernel(sampling, shapingTime, nPoints, 1E-9);
+    const Double_t maximum = *max_element(expected.begin(), expected.end());
+
+    EXPECT_FALSE(kernel.empty());
+    EXPECT_NEAR(*max_element(kernel.begin(), kernel.end()), 1.0, 1E-12);
+    for (size_t i = 0; i < min(kernel.size(), expected.size()); i++) {
+        EXPECT_NEAR(kernel[i], expected[i] / maximum, 1E-9);
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ShapingCRRC) {
+    const Int_t nPoints = 512;
+    const Double_t sampling = 0.04;
+    const Double_t shapingTime = 0.5;
+
+    vector<Double_t> deposits(nPoints, 0.0);
+    for (int i = 0; i < nPoints; i++) {
+        deposits[i] = (i % 37 == 0) ? 1000.0 + 10.0 * i : -1.0;
+    }
+
+    for (Int_t order = 1; order <= 10; order++) {
+        // the CR-RC^n response tabulated from its analytic expression, peaking at the shaping time
+        const Double_t tau = shapingTime / order;
+        vector<Double_t> kernel(nPoints);
+        for (int i = 0; i < nPoints; i++) {
+            const Double_t t = i * sampling / tau;
+            kernel[i] = pow(t / order, order) * exp(order - t);
+        }
+
+        vector<Double_t> direct(nPoints);
+        TRestDetectorSignalToRawSignalProcess::ShapeDirect(deposits.data(), direct.data(), nPoints, kernel);
+        vector<Double_t> recursive(nPoints);
+        TRestDetectorSignalToRawSignalProcess::ShapeCRRC(deposits.data(), recursive.data(), nPoints, sampling,
+                                                         shapingTime, order);
+
+        const Double_t maxAmplitude = *max_element(direct.begin(), direct.end());
+        for (int i = 0; i < nPoints; i++) {
+            EXPECT_NEAR(direct[i], recursive[i], 1E-9 * maxAmplitude);
+        }
+    }
+
+    // with an uncompensated preamplifier decay the pulse is followed by an undershoot of zero total area
+    vector<Double_t> impulse(nPoints, 0.0);
+    impulse[10] = 1.0;
+    vector<Double_t> undershoot(nPoints);
+    TRestDetectorSignalToRawSignalProcess::ShapeCRRC(impulse.data(), undershoot.data(), nPoints, sampling,
+                                                     shapingTime, 4, 1.0);
+    EXPECT_TRUE(*min_element(undershoot.begin(), undershoot.end()) < -0.1);
+    Double_t area = 0;
+    Double_t absoluteArea = 0;
+    for (const auto& value : undershoot) {
+        area += value;
+        absoluteArea += abs(value);
+    }
+    EXPECT_NEAR(area, 0, 1E-3 * absoluteArea);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, QuantizeToADC) {
+    const vector<Double_t> input = {0.0,     0.49999999999999994, 0.5,     -0.5,    2.5,
+                                    -2.5,    1234.4,              32767.4, -32768.4};
+    vector<Short_t> output(input.size());
+    EXPECT_FALSE(TRestDetectorSignalToRawSignalProcess::QuantizeToADC(input.data(), output.data(),
+                                                                     input.size()));
+    for (size_t i = 0; i < input.size(); i++) {
+        EXPECT_EQ(output[i], (Short_t)round(input[i]));
+    }
+
+    const vector<Double_t> overflow = {32767.5, -32768.5, 1.0E9, -1.0E9};
+    output.resize(overflow.size());
+    EXPECT_TRUE(TRestDetectorSignalToRawSignalProcess::QuantizeToADC(overflow.data(), output.data(),
+                                                                    overflow.size()));
+    EXPECT_EQ(output[0], 32767);
+    EXPECT_EQ(output[1], -32768);
+    EXPECT_EQ(output[2], 32767);
+    EXPECT_EQ(output[3], -32768);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ZeroSuppress) {
+    vector<Short_t> samples(20, 100);
+    samples[5] = 131;
+    samples[7] = 140;
+    samples[16] = 135;
+    EXPECT_TRUE(TRestDetectorSignalToRawSignalProcess::ZeroSuppress(samples.data(), samples.size(), 100, 30,
+                                                                    2, 1));
+    const vector<Short_t> expected = {0, 0, 0, 100, 100, 131, 100, 140, 100, 0,
+                                      0, 0, 0, 0,   100, 100, 135, 100, 0,   0};
+    EXPECT_TRUE(samples == expected);
+
+    vector<Short_t> baseline(20, 120);
+    EXPECT_FALSE(TRestDetectorSignalToRawSignalProcess::ZeroSuppress(baseline.data(), baseline.size(), 100,
+                                                                     30, 2, 1));
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, NoiseStreams) {
+    const Int_t nPoints = 64;
+    TRestDetectorSignalToRawSignalProcess::NoiseStream stream;
+    stream.subEventID = 1;
+    stream.stage = 1;
+    auto otherStream = stream;
+    otherStream.subEventID = 0;
+    otherStream.stage = 3;
+
+    // the streams of different sub-events and stages are independent
+    vector<Double_t> noise(nPoints, 0.0);
+    vector<Double_t> otherNoise(nPoints, 0.0);
+    TRestDetectorSignalToRawSignalProcess::AddNoise(noise.data(), nPoints, 1.0, stream);
+    TRestDetectorSignalToRawSignalProcess::AddNoise(otherNoise.data(), nPoints, 1.0, otherStream);
+    EXPECT_TRUE(noise != otherNoise);
+
+    // the library noise is a (wrapped around) segment of one of the library waveforms
+    const Int_t waveformLength = 10;
+    vector<Float_t> library;
+    for (int w = 0; w < 3; w++) {
+        for (int j = 0; j < waveformLength; j++) {
+            library.push_back(100 * w + j);
+        }
+    }
+    vector<Double_t> libraryNoise(25, 0.0);
+    TRestDetectorSignalToRawSignalProcess::AddLibraryNoise(libraryNoise.data(), libraryNoise.size(), library,
+                                                           waveformLength, stream);
+    const Int_t waveform = (Int_t)libraryNoise[0] / 100;
+    const Int_t offset = (Int_t)libraryNoise[0] % 100;
+    for (int i = 0; i < (int)libraryNoise.size(); i++) {
+        EXPECT_EQ(libraryNoise[i], 100 * waveform + (offset + i) % waveformLength);
+    }
+
+    // and it only depends on the stream
+    vector<Double_t> sameNoise(25, 0.0);
+    TRestDetectorSignalToRawSignalProcess::AddLibraryNoise(sameNoise.data(), sameNoise.size(), library,
+                                                           waveformLength, stream);
+    EXPECT_TRUE(sameNoise == libraryNoise);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, IntegralThreshold) {
+    TRestDetectorSignalToRawSignalProcess process;
+    const Double_t sampling = process.GetSampling();
+    const Int_t nPoints = process.GetNPoints();
+    const Double_t step = process.GetIntegralThresholdStep();
+    EXPECT_EQ(step, 0.5);
+    EXPECT_EQ(process.GetIntegralThresholdCrossing(), "last");
+
+    mt19937 generator(4321);
+    uniform_real_distribution<Double_t> uniform(0, 1);
+    exponential_distribution<Double_t> energyDistribution(0.2);
+
+    for (int event = 0; event < 50; event++) {
+        TRestDetectorSignalEvent signalEvent;
+        vector<TRestDetectorSignal> signals(1 + event % 5);
+        Double_t totalEnergy = 0;
+        for (size_t n = 0; n < signals.size(); n++) {
+            signals[n].SetID(n);
+            const Int_t nDeposits = 1 + generator() % 20;
+            for (int i = 0; i < nDeposits; i++) {
+                const Double_t energy = energyDistribution(generator);
+                signals[n].NewPoint(1000 * uniform(generator), energy);
+                totalEnergy += energy;
+            }
+            signalEvent.AddSignal(signals[n]);
+        }
+        const Double_t threshold = 0.8 * totalEnergy * uniform(generator);
+
+        vector<const TRestDetectorSignal*> signalPointers;
+        for (const auto& signal : signals) {
+            signalPointers.push_back(&signal);
+        }
+        TRestDetectorSignalToRawSignalProcess::DepositIndex deposits;
+        TRestDetectorSignalToRawSignalProcess::BuildDepositIndex(signalPointers, deposits);
+
+        // the full scan of the event, keeping the first and the last crossing of the threshold. The
+        // second step is not a power of two, so the accumulated scan times carry rounding errors.
+        for (const Double_t scanStep : {step, 0.07}) {
+            Bool_t expectedReached = false;
+            Double_t expectedFirst = 0;
+            Double_t expectedLast = 0;
+            for (Double_t t = signalEvent.GetMinTime() - nPoints * sampling;
+                 t <= signalEvent.GetMaxTime() + nPoints * sampling; t = t + scanStep) {
+                const Double_t energy = signalEvent.GetIntegralWithTime(t, t + (sampling * nPoints) / 2.);
+                if (energy > threshold) {
+                    if (!expectedReached) {
+                        expectedFirst = t;
+                    }
+                    expectedLast = t;
+                    expectedReached = true;
+                }
+            }
+
+            for (const Bool_t firstCrossing : {false, true}) {
+                Double_t startTime = 0;
+                const Bool_t reached = TRestDetectorSignalToRawSignalProcess::FindIntegralThresholdTime(
+                    deposits, signalEvent.GetMinTime(), signalEvent.GetMaxTime(), sampling, nPoints,
+                    scanStep, threshold, firstCrossing, startTime);
+                EXPECT_EQ(reached, expectedReached);
+                if (reached && expectedReached) {
+                    EXPECT_EQ(startTime, firstCrossing ? expectedFirst : expectedLast);
+                }
+            }
+        }
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, IntegralThresholdTPC) {
+    // not a power of two, so the accumulated trigger times carry rounding errors
+    const Double_t sampling = 0.04;
+    const Int_t nPoints = 64;
+
+    mt19937 generator(1234);
+    uniform_real_distribution<Double_t> uniform(0, 1);
+    exponential_distribution<Double_t> energyDistribution(0.2);
+
+    for (int event = 0; event < 50; event++) {
+        // a few signals with clusters of deposits separated by long empty gaps
+        vector<TRestDetectorSignal> signals(1 + event % 5);
+        Double_t totalEnergy = 0;
+        for (size_t n = 0; n < signals.size(); n++) {
+            signals[n].SetID(n);
+            const Int_t nClusters = 1 + generator() % 3;
+            for (int c = 0; c < nClusters; c++) {
+                const Double_t clusterTime = 500 * uniform(generator);
+                const Int_t nDeposits = 1 + generator() % 10;
+                for (int i = 0; i < nDeposits; i++) {
+                    const Double_t energy = energyDistribution(generator);
+                    signals[n].NewPoint(clusterTime + 5 * uniform(generator), energy);
+                    totalEnergy += energy;
+                }
+            }
+        }
+        const Double_t threshold = 1.2 * totalEnergy * uniform(generator);
+
+        vector<const TRestDetectorSignal*> signalPointers;
+        Double_t minTime = signals[0].GetMinTime();
+        Double_t maxTime = signals[0].GetMaxTime();
+        for (const auto& signal : signals) {
+            signalPointers.push_back(&signal);
+            minTime = min(minTime, signal.GetMinTime());
+            maxTime = max(maxTime, signal.GetMaxTime());
+        }
+
+        // the scan of the trigger times integrating every signal at every step
+        Bool_t expectedReached = false;
+        Double_t expectedTime = minTime;
+        while (expectedTime <= maxTime + sampling) {
+            Double_t energy = 0;
+            for (auto& signal : signals) {
+                energy += signal.GetIntegralWithTime(expectedTime - sampling * nPoints, expectedTime);
+            }
+            if (energy >= threshold) {
+                expectedReached = true;
+                break;
+            }
+            expectedTime += sampling;
+        }
+
+        TRestDetectorSignalToRawSignalProcess::DepositIndex deposits;
+        TRestDetectorSignalToRawSignalProcess::BuildDepositIndex(signalPointers, deposits);
+        Double_t triggerTime = 0;
+        const Bool_t reached = TRestDetectorSignalToRawSignalProcess::FindIntegralThresholdTPCTime(
+            deposits, minTime, maxTime, sampling, nPoints, threshold, triggerTime);
+        EXPECT_EQ(reached, expectedReached);
+        if (reached && expectedReached) {
+            EXPECT_EQ(triggerTime, expectedTime);
+        }
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, SinglePrecision) {
+    TRestDetectorSignalToRawSignalProcess process;
+    const Int_t nPoints = process.GetNPoints();
+
+    TRestDetectorSignalToRawSignalProcess::Parameters parameters;
+    parameters.sampling = 0.1;
+    parameters.shapingTime = 0.5;
+    parameters.noiseLevel = 5.0;
+    parameters.calibrationOffset = 250;
+    parameters.shapingKernel = TRestDetectorSignalToRawSignalProcess::GetShapingKernel(
+        parameters.sampling, parameters.shapingTime, nPoints, 1E-9);
+    parameters.shapingKernelSpectrum =
+        TRestDetectorSignalToRawSignalProcess::GetShapingKernelSpectrum(parameters.shapingKernel, nPoints);
+
+    auto singleParameters = parameters;
+    singleParameters.singlePrecision = true;
+    singleParameters.shapingKernelFloat.assign(parameters.shapingKernel.begin(),
+                                               parameters.shapingKernel.end());
+
+    TRestDetectorSignal signal;
+    signal.SetID(1);
+    for (int i = 0; i < nPoints; i += 3) {
+        signal.NewPoint(i * parameters.sampling, 0.1 + (i % 11));
+    }
+
+    TRestDetectorSignalToRawSignalProcess::NoiseStream stream;
+    TRestDetectorSignalToRawSignalProcess::SynthesisBuffers buffers;
+    vector<Short_t> output(nPoints);
+    vector<Short_t> singleOutput(nPoints);
+
+    const Double_t startTime = process.GetTriggerDelay() * parameters.sampling;
+    Int_t differentSamples = 0;
+    for (int event = 0; event < 20; event++) {
+        stream.eventID = event;
+        process.SynthesizeSignal(&signal, parameters, startTime, stream, buffers, output.data());
+        process.SynthesizeSignal(&signal, singleParameters, startTime, stream, buffers, singleOutput.data());
+        for (int i = 0; i < nPoints; i++) {
+            EXPECT_LE(abs(output[i] - singleOutput[i]), 1);
+            differentSamples += output[i] != singleOutput[i];
+        }
+    }
+    EXPECT_LT(differentSamples, 20 * nPoints / 100);
+
+    // the single precision quantization rounds as the double precision one
+    const vector<Float_t> values = {-0.5f, 0.5f, 1.4999999f, -2.5f, 32766.5f, -32768.5f};
+    vector<Short_t> expected(values.size());
+    vector<Short_t> quantized(values.size());
+    const vector<Double_t> doubleValues(values.begin(), values.end());
+    TRestDetectorSignalToRawSignalProcess::QuantizeToADC(doubleValues.data(), expected.data(),
+                                                         values.size());
+    TRestDetectorSignalToRawSignalProcess::QuantizeToADC(values.data(), quantized.data(), values.size());
+    EXPECT_TRUE(quantized == expected);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ChannelThreads) {
+    TRestDetectorSignalEvent inputEvent;
+    inputEvent.SetID(7);
+    mt19937 generator(99);
+    uniform_real_distribution<Double_t> uniform(0, 1);
+    for (int n = 0; n < 200; n++) {
+        TRestDetectorSignal signal;
+        signal.SetID(n);
+        for (int i = 0; i <= n % 20; i++) {
+            signal.NewPoint(20 + 20 * uniform(generator), 10 * uniform(generator));
+        }
+        inputEvent.AddSignal(signal);
+    }
+
+    // the same event synthesized by one and by several threads
+    vector<vector<Double_t>> outputs;
+    for (const int channelThreads : {1, 4}) {
+        const string configFile = "signalToRawSignalThreads.rml";
+        ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"threads\">\n"
+                             << "    <parameter name=\"sampling\" value=\"0.1us\"/>\n"
+                             << "    <parameter name=\"shapingTime\" value=\"0.5us\"/>\n"
+                             << "    <parameter name=\"shapingMethod\" value=\"fft\"/>\n"
+                             << "    <parameter name=\"noiseLevel\" value=\"5\"/>\n"
+                             << "    <parameter name=\"channelThreads\" value=\"" << channelThreads
+                             << "\"/>\n"
+                             << "</TRestDetectorSignalToRawSignalProcess>\n";
+        TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+        process.InitProcess();
+
+        // the second event is synthesized by the same worker threads
+        for (int event = 0; event < 2; event++) {
+            const auto output = (TRestRawSignalEvent*)process.ProcessEvent(&inputEvent);
+            ASSERT_TRUE(output != nullptr);
+            EXPECT_EQ(output->GetNumberOfSignals(), inputEvent.GetNumberOfSignals());
+            vector<Double_t> samples;
+            for (int n = 0; n < output->GetNumberOfSignals(); n++) {
+                const auto signal = output->GetSignal(n);
+                samples.push_back(signal->GetID());
+                for (int i = 0; i < signal->GetNumberOfPoints(); i++) {
+                    samples.push_back(signal->GetData(i));
+                }
+            }
+            outputs.push_back(samples);
+        }
+        process.EndProcess();
+    }
+
+    for (const auto& samples : outputs) {
+        EXPECT_TRUE(samples == outputs[0]);
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ChannelCalibration) {
+    const string calibrationFile = "signalToRawSignalChannels.txt";
+    ofstream(calibrationFile) << "# signalID gain offset\n"
+                              << "3 2.0 50\n"
+                              << "\n"
+                              << "7 0.5\n";
+    const string configFile = "signalToRawSignalChannels.rml";
+    ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"channels\">\n"
+                         << "    <parameter name=\"channelCalibration\" value=\"" << calibrationFile
+                         << "\"/>\n"
+                         << "</TRestDetectorSignalToRawSignalProcess>\n";
+    TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+    process.InitProcess();
+
+    const Double_t gain = process.GetGain();
+    EXPECT_EQ(process.GetADCFromEnergyForSignal(3, 1.0), 2.0 * gain + 50);
+    EXPECT_EQ(process.GetADCFromEnergyForSignal(7, 1.0), 0.5 * gain);
+    EXPECT_EQ(process.GetADCFromEnergyForSignal(5, 1.0), gain);
+    EXPECT_EQ(process.GetADCFromEnergy(1.0), gain);
+    EXPECT_DOUBLE_EQ(process.GetEnergyFromADCForSignal(3, 2.0 * gain + 50), 1.0);
+    EXPECT_DOUBLE_EQ(process.GetEnergyFromADCForSignal(7, 0.5 * gain), 1.0);
+    // the readout type calibration ignores the channel calibration
+    EXPECT_EQ(process.GetADCFromEnergy(2.0), 2.0 * gain);
+
+    // the array conversions give the same values as the single value ones
+    const auto parameters = process.GetParametersHandle();
+    ASSERT_TRUE(parameters != nullptr);
+    EXPECT_TRUE(process.GetParametersHandle("undefined") == nullptr);
+    const vector<Double_t> energies = {0.0, 1.0, 2.5, -0.5};
+    vector<Double_t> adcs(energies.size());
+    vector<Double_t> converted(energies.size());
+    process.GetADCFromEnergy(*parameters, energies.data(), adcs.data(), energies.size());
+    process.GetEnergyFromADC(*parameters, adcs.data(), converted.data(), adcs.size());
+    for (size_t i = 0; i < energies.size(); i++) {
+        EXPECT_EQ(adcs[i], process.GetADCFromEnergy(energies[i]));
+        EXPECT_DOUBLE_EQ(converted[i], energies[i]);
+    }
+    for (const Int_t signalID : {3, 5, 7}) {
+        process.GetADCFromEnergyForSignal(*parameters, signalID, energies.data(), adcs.data(),
+                                          energies.size());
+        process.GetEnergyFromADCForSignal(*parameters, signalID, adcs.data(), converted.data(), adcs.size());
+        for (size_t i = 0; i < energies.size(); i++) {
+            EXPECT_EQ(adcs[i], process.GetADCFromEnergyForSignal(signalID, energies[i]));
+            EXPECT_DOUBLE_EQ(converted[i], energies[i]);
+        }
+    }
+    const vector<Double_t> bins = {0.0, 100.0, 255.0, 511.0};
+    vector<Double_t> times(bins.size());
+    vector<Double_t> convertedBins(bins.size());
+    process.GetTimeFromBin(*parameters, bins.data(), times.data(), bins.size());
+    process.GetBinFromTime(*parameters, times.data(), convertedBins.data(), times.size());
+    for (size_t i = 0; i < bins.size(); i++) {
+        EXPECT_EQ(times[i], process.GetTimeFromBin(bins[i]));
+        EXPECT_DOUBLE_EQ(times[i], (bins[i] - process.GetTriggerDelay()) * process.GetSampling());
+        EXPECT_DOUBLE_EQ(convertedBins[i], bins[i]);
+    }
+
+    // the synthesis applies the same channel calibration
+    TRestDetectorSignalEvent event;
+    for (const Int_t signalID : {3, 5, 7}) {
+        TRestDetectorSignal signal;
+        signal.SetID(signalID);
+        signal.NewPoint(10, 1.0);
+        event.AddSignal(signal);
+    }
+    const auto output = (TRestRawSignalEvent*)process.ProcessEvent(&event);
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(output->GetNumberOfSignals(), 3);
+    for (int n = 0; n < output->GetNumberOfSignals(); n++) {
+        const auto signal = output->GetSignal(n);
+        EXPECT_EQ(signal->GetData(0), process.GetADCFromEnergyForSignal(signal->GetID(), 0.0));
+        EXPECT_EQ(signal->GetData(process.GetTriggerDelay()),
+                  process.GetADCFromEnergyForSignal(signal->GetID(), 1.0));
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, SignalTypeParameters) {
+    const string configFile = "signalToRawSignalTypes.rml";
+    ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"types\">\n"
+                         << "    <parameter name=\"readoutTypes\" value=\"tpc,veto\"/>\n"
+                         << "    <parameter name=\"gainTpc\" value=\"200\"/>\n"
+                         << "    <parameter name=\"gainVeto\" value=\"300\"/>\n"
+                         << "</TRestDetectorSignalToRawSignalProcess>\n";
+    TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+    process.InitProcess();
+
+    // the parameters follow the signal type, also when the type of a signal ID changes between events
+    const vector<vector<string>> eventTypes = {{"tpc", "veto", ""}, {"veto", "", "tpc"}};
+    for (const auto& types : eventTypes) {
+        TRestDetectorSignalEvent event;
+        for (size_t n = 0; n < types.size(); n++) {
+            TRestDetectorSignal signal;
+            signal.SetID(n);
+            signal.SetSignalType(types[n]);
+            signal.NewPoint(10, 1.0);
+            event.AddSignal(signal);
+        }
+        const auto output = (TRestRawSignalEvent*)process.ProcessEvent(&event);
+        ASSERT_TRUE(output != nullptr);
+        ASSERT_EQ(output->GetNumberOfSignals(), 3);
+        for (int n = 0; n < output->GetNumberOfSignals(); n++) {
+            const auto signal = output->GetSignal(n);
+            EXPECT_EQ(signal->GetData(process.GetTriggerDelay()),
+                      process.GetADCFromEnergy(1.0, types[signal->GetID()]));
+        }
+        // as done by the framework before each event
+        output->Initialize();
+    }
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, ZeroSuppressedEvent) {
+    const string configFile = "signalToRawSignalZeroSuppression.rml";
+    ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"zeroSuppression\">\n"
+                         << "    <parameter name=\"zeroSuppressionThreshold\" value=\"100\"/>\n"
+                         << "</TRestDetectorSignalToRawSignalProcess>\n";
+    TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+    process.InitProcess();
+
+    // 0.5 keV give 50 ADC counts with the default gain, below the zero suppression threshold
+    TRestDetectorSignalEvent event;
+    for (int n = 0; n < 3; n++) {
+        TRestDetectorSignal signal;
+        signal.SetID(n);
+        signal.NewPoint(10 + n, 0.5);
+        event.AddSignal(signal);
+    }
+    EXPECT_TRUE(process.ProcessEvent(&event) == nullptr);
+
+    // a single signal above the threshold keeps the event
+    TRestDetectorSignal signal;
+    signal.SetID(3);
+    signal.NewPoint(11, 5.0);
+    event.AddSignal(signal);
+    const auto output = (TRestRawSignalEvent*)process.ProcessEvent(&event);
+    ASSERT_TRUE(output != nullptr);
+    EXPECT_EQ(output->GetNumberOfSignals(), 1);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, TriggerWindows) {
+    const string configFile = "signalToRawSignalWindows.rml";
+    ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"windows\">\n"
+                         << "    <parameter name=\"triggerWindows\" value=\"3\"/>\n"
+                         << "</TRestDetectorSignalToRawSignalProcess>\n";
+    TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+    process.InitProcess();
+
+    // a group of deposits at 20 us and a delayed one at 900 us, after the end of the first window
+    TRestDetectorSignalEvent event;
+    const vector<vector<pair<Double_t, Double_t>>> deposits = {
+        {{20, 1.0}, {900, 3.0}}, {{25, 2.0}}, {{905, 4.0}}};
+    for (size_t n = 0; n < deposits.size(); n++) {
+        TRestDetectorSignal signal;
+        signal.SetID(n + 1);
+        for (const auto& deposit : deposits[n]) {
+            signal.NewPoint(deposit.first, deposit.second);
+        }
+        event.AddSignal(signal);
+    }
+
+    const auto output = (TRestRawSignalEvent*)process.ProcessEvent(&event);
+    ASSERT_TRUE(output != nullptr);
+    EXPECT_TRUE(process.GetTriggerWindowTimes() == vector<Double_t>({20, 900}));
+
+    const auto getSignal = [](TRestRawSignalEvent* rawEvent, Int_t signalID) -> TRestRawSignal* {
+        for (int n = 0; n < rawEvent->GetNumberOfSignals(); n++) {
+            if (rawEvent->GetSignal(n)->GetSignalID() == signalID) {
+                return rawEvent->GetSignal(n);
+            }
+        }
+        return nullptr;
+    };
+    const Int_t delay = process.GetTriggerDelay();
+    const Double_t gain = process.GetGain();
+    const Int_t offset = process.GetTriggerWindowIDOffset();
+
+    // both windows are in the output event, the second one with shifted signal IDs
+    EXPECT_EQ(output->GetSubID(), 0);
+    ASSERT_EQ(output->GetNumberOfSignals(), 6);
+    for (Int_t signalID = 1; signalID <= 3; signalID++) {
+        ASSERT_TRUE(getSignal(output, signalID) != nullptr);
+        ASSERT_TRUE(getSignal(output, signalID + offset) != nullptr);
+    }
+    EXPECT_EQ(getSignal(output, 1)->GetData(delay), gain * 1.0);
+    EXPECT_EQ(getSignal(output, 2)->GetData(delay + 5), gain * 2.0);
+    EXPECT_EQ(getSignal(output, 1 + offset)->GetData(delay), gain * 3.0);
+    EXPECT_EQ(getSignal(output, 3 + offset)->GetData(delay + 5), gain * 4.0);
+    // the delayed deposits are not in the first window
+    for (int i = 0; i < process.GetNPoints(); i++) {
+        EXPECT_EQ(getSignal(output, 3)->GetData(i), 0);
+        EXPECT_EQ(getSignal(output, 2 + offset)->GetData(i), 0);
+    }
+
+    // the second window as a separate event keeps the signal IDs
+    const auto windowEvent = process.GetWindowEvent(1);
+    ASSERT_TRUE(windowEvent != nullptr);
+    EXPECT_EQ(windowEvent->GetSubID(), 1);
+    ASSERT_EQ(windowEvent->GetNumberOfSignals(), 3);
+    EXPECT_EQ(getSignal(windowEvent, 3)->GetData(delay + 5), gain * 4.0);
+    EXPECT_TRUE(process.GetWindowEvent(2) == nullptr);
+}
+
+TEST(TRestDetectorSignalToRawSignalProcess, Streaming) {
+    const string configFile = "signalToRawSignalStreaming.rml";
+    const auto writeConfig = [&](const string& parameters) {
+        ofstream(configFile) << "<TRestDetectorSignalToRawSignalProcess name=\"streaming\">\n"
+                             << "    <parameter name=\"streaming\" value=\"true\"/>\n"
+                             << "    <parameter name=\"integralThreshold\" value=\"10\"/>\n"
+                             << "    <parameter name=\"readoutTypes\" value=\"veto\"/>\n"
+                             << "    <parameter name=\"offsetVeto\" value=\"1000\"/>\n"
+                             << parameters << "</TRestDetectorSignalToRawSignalProcess>\n";
+    };
+    const auto makeEvent = [](const vector<Double_t>& times, Double_t energy) {
+        TRestDetectorSignalEvent event;
+        TRestDetectorSignal signal;
+        signal.SetID(5);
+        signal.SetSignalType("veto");
+        for (const Double_t time : times) {
+            signal.NewPoint(time, energy);
+        }
+        event.AddSignal(signal);
+        return event;
+    };
+    const auto getSignal = [](TRestRawSignalEvent* rawEvent, Int_t signalID) -> TRestRawSignal* {
+        for (int n = 0; n < rawEvent->GetNumberOfSignals(); n++) {
+            if (rawEvent->GetSignal(n)->GetSignalID() == signalID) {
+                return rawEvent->GetSignal(n);
+            }
+        }
+        return nullptr;
+    };
+
+    // the three frames completed by the first event are all written to its output event
+    writeConfig(
+        "    <parameter name=\"streamEventSpacing\" value=\"2000us\"/>\n"
+        "    <parameter name=\"streamDeadTime\" value=\"50us\"/>\n");
+    TRestDetectorSignalToRawSignalProcess process(configFile.c_str());
+    process.InitProcess();
+    const Int_t delay = process.GetTriggerDelay();
+    const Double_t gain = process.GetGain();
+    const Int_t offset = process.GetTriggerWindowIDOffset();
+
+    auto event = makeEvent({10, 200, 400}, 20);
+    const auto output = (TRestRawSignalEvent*)process.ProcessEvent(&event);
+    ASSERT_TRUE(output != nullptr);
+    EXPECT_EQ(output->GetSubID(), 0);
+    EXPECT_EQ(process.GetStreamFrames(), 3);
+    EXPECT_EQ(process.GetStreamPendingFrames(), 0);
+    ASSERT_EQ(output->GetNumberOfSignals(), 3);
+    for (int frame = 0; frame < 3; frame++) {
+        const TRestRawSignal* signal = getSignal(output, 5 + frame * offset);
+        ASSERT_TRUE(signal != nullptr);
+        // the frame signals keep the type of the input signal, and so its offset
+        EXPECT_EQ(signal->GetData(0), 1000);
+        EXPECT_EQ(signal->GetData(delay), 1000 + 20 * gain);
+    }
+    EXPECT_EQ(getSignal(output, 5)->GetData(delay + 190), 1000 + 20 * gain);
+    process.EndProcess();
+
+    // the frames beyond the pending frames queue size are dropped, the oldest ones are kept
+    writeConfig(
+        "    <parameter name=\"streamDeadTime\" value=\"5us\"/>\n"
+        "    <parameter name=\"streamMaxPendingFrames\" value=\"2\"/>\n");
+    TRestDetectorSignalToRawSignalProcess pendingProcess(configFile.c_str());
+    pendingProcess.InitProcess();
+
+    event = makeEvent({150, 160, 170, 180}, 20);
+    EXPECT_TRUE(pendingProcess.ProcessEvent(&event) == nullptr);
+    EXPECT_EQ(pendingProcess.GetStreamPendingFrames(), 2);
+    EXPECT_EQ(pendingProcess.GetStreamDroppedFrames(), 2);
+
+    event = makeEvent({400}, 1);
+    const auto pendingOutput = (TRestRawSignalEvent*)pendingProcess.ProcessEvent(&event);
+    ASSERT_TRUE(pendingOutput != nullptr);
+    EXPECT_EQ(pendingProcess.GetStreamFrames(), 2);
+    EXPECT_EQ(pendingProcess.GetStreamPendingFrames(), 0);
+    ASSERT_EQ(pendingOutput->GetNumberOfSignals(), 2);
+    ASSERT_TRUE(getSignal(pendingOutput, 5 + offset) != nullptr);
+    // the second frame is triggered by the deposit at 160
+    EXPECT_EQ(getSignal(pendingOutput, 5 + offset)->GetData(delay), 1000 + 20 * gain);
+    EXPECT_EQ(getSignal(pendingOutput, 5 + offset)->GetData(delay - 10), 1000 + 20 * gain);
+    pendingProcess.EndProcess();
+
+    // a full buffer drops the pending frame instead of the deposits it needs
+    writeConfig("    <parameter name=\"streamBufferSize\" value=\"3\"/>\n");
+    TRestDetectorSignalToRawSignalProcess smallBufferProcess(configFile.c_str());
+    smallBufferProcess.InitProcess();
+
+    event = makeEvent({200}, 20);
+    EXPECT_TRUE(smallBufferProcess.ProcessEvent(&event) == nullptr);
+    EXPECT_EQ(smallBufferProcess.GetStreamPendingFrames(), 1);
+
+    event = makeEvent({10, 20, 30, 40}, 1);
+    EXPECT_TRUE(smallBufferProcess.ProcessEvent(&event) == nullptr);
+    EXPECT_EQ(smallBufferProcess.GetStreamPendingFrames(), 0);
+    EXPECT_EQ(smallBufferProcess.GetStreamDroppedFrames(), 1);
+    EXPECT_EQ(smallBufferProcess.GetStreamDroppedDeposits(), 2);
+    smallBufferProcess.EndProcess();
+
+    // the last entry of the run flushes the stream
+    const string runFile = "signalToRawSignalStreamingRun.root";
+    {
+        TRestRun outputRun;
+        outputRun.SetOutputFileName(runFile);
+        outputRun.FormOutputFile();
+        TRestRawSignalEvent runEvent;
+        outputRun.AddEventBranch(&runEvent);
+        for (int entry = 0; entry < 2; entry++) {
+            outputRun.GetEventTree()->Fill();
+            outputRun.GetAnalysisTree()->Fill();
+        }
+        outputRun.CloseFile();
+    }
+    TRestRun run(runFile);
+    writeConfig("");
+    TRestDetectorSignalToRawSignalProcess flushProcess(configFile.c_str());
+    flushProcess.SetRunInfo(&run);
+    flushProcess.InitProcess();
+
+    event = makeEvent({400}, 20);
+    EXPECT_TRUE(flushProcess.ProcessEvent(&event) == nullptr);
+    event = makeEvent({10}, 1);
+    const auto flushOutput = (TRestRawSignalEvent*)flushProcess.ProcessEvent(&event);
+    ASSERT_TRUE(flushOutput != nullptr);
+    EXPECT_EQ(flushProcess.GetStreamFrames(), 1);
+    EXPECT_EQ(flushProcess.GetStreamPendingFrames(), 0);
+    ASSERT_EQ(flushOutput->GetNumberOfSignals(), 1);
+    // the deposit of the last event at 512 + 10 is in the frame triggered at 400
+    EXPECT_EQ(flushOutput->GetSignal(0)->GetData(delay), 1000 + 20 * gain);
+    EXPECT_EQ(flushOutput->GetSignal(0)->GetData(delay + 122), 1000 + gain);
+    flushProcess.EndProcess();
+}
+
+TEST(TRestRawToDetectorSignalProcess, PointsOverThreshold) {
+    TRestRawToDetectorSignalProcess process;
+    mt19937 generator(1);
+    normal_distribution<Double_t> noise(0, 8);
+
+    for (int n = 0; n < 50; n++) {
+        TRestRawSignal rawSignal;
+        vector<Short_t> samples(512);
+        for (int p = 0; p < (int)samples.size(); p++) {
+            Double_t value = 250 + noise(generator);
+            // a few pulses of different amplitudes and widths
+            for (int pulse = 0; pulse < n % 4; pulse++) {
+                const Double_t t = p - 100.0 - 120 * pulse;
+                value += t > 0 ? (n * 10 + 50) * pow(t / 10, 3) * exp(-t / 5) : 0;
+            }
+            samples[p] = (Short_t)value;
+            rawSignal.AddPoint(samples[p]);
+        }
+
+        rawSignal.CalculateBaseLine(5, 55);
+        rawSignal.SetRange(TVector2(10, 500));
+        rawSignal.InitializePointsOverThreshold(TVector2(3, 5), 5, 512);
+
+        vector<Int_t> points;
+        Double_t baseLine;
+        Double_t baseLineSigma;
+        process.CalculateBaseLine(samples.data(), samples.size(), baseLine, baseLineSigma);
+        process.FindPointsOverThreshold(samples.data(), samples.size(), baseLine, baseLineSigma, points);
+        EXPECT_DOUBLE_EQ(baseLine, rawSignal.GetBaseLine());
+        EXPECT_DOUBLE_EQ(baseLineSigma, rawSignal.GetBaseLineSigma());
+        EXPECT_TRUE(points == rawSignal.GetPointsOverThreshold());
+
+        // without zero suppression, all the points over the (default) threshold are kept
+        vector<Int_t> expected;
+        for (int p = 0; p < (int)samples.size(); p++) {
+            if (rawSignal.GetData(p) > 0.1) {
+                expected.push_back(p);
+            }
+        }
+        process.FindPointsAboveThreshold(samples.data(), samples.size(), baseLine, points);
+        EXPECT_TRUE(points == expected);
+    }
+}
+
+TEST(TRestRawToDetectorSignalProcess, Pedestals) {
+    // raw signals with a noise of +-2 ADC around `baseLine`, shifted by `shift` in the first 60 bins,
+    // and a triangular pulse of 100 ADC at bin 200
+    const auto makeSignal = [](Int_t signalID, Short_t baseLine, bool pulse, Short_t shift = 0) {
+        TRestRawSignal signal;
+        signal.SetSignalID(signalID);
+        for (int p = 0; p < 512; p++) {
+            Short_t sample = baseLine + (p % 2 == 0 ? -2 : 2) + (p < 60 ? shift : 0);
+            if (pulse && p >= 200 && p < 220) {
+                sample += 10 * (p < 210 ? p - 199 : 220 - p);
+            }
+            signal.AddPoint(sample);
+        }
+        return signal;
+    };
+
+    // the pedestal run has channels 1 and 3 only
+    const string runFile = "rawToSignalPedestals.root";
+    {
+        TRestRun run;
+        run.SetOutputFileName(runFile);
+        run.FormOutputFile();
+        TRestRawSignalEvent event;
+        run.AddEventBranch(&event);
+        TRestRawSignal signal = makeSignal(1, 250, false);
+        TRestRawSignal otherSignal = makeSignal(3, 100, false);
+        for (int entry = 0; entry < 2; entry++) {
+            event.Initialize();
+            event.AddSignal(signal);
+            event.AddSignal(otherSignal);
+            run.GetEventTree()->Fill();
+            run.GetAnalysisTree()->Fill();
+        }
+        run.CloseFile();
+    }
+
+    const string configFile = "rawToSignalPedestals.rml";
+    const auto writeConfig = [&](Double_t updateFactor) {
+        ofstream(configFile) << "<TRestRawToDetectorSignalProcess name=\"pedestals\">\n"
+                             << "    <parameter name=\"zeroSuppression\" value=\"true\"/>\n"
+                             << "    <parameter name=\"pedestalRun\" value=\"" << runFile << "\"/>\n"
+                             << "    <parameter name=\"pedestalUpdateFactor\" value=\"" << updateFactor
+                             << "\"/>\n"
+                             << "</TRestRawToDetectorSignalProcess>\n";
+    };
+    writeConfig(0);
+    TRestRawToDetectorSignalProcess process(configFile.c_str());
+    process.InitProcess();
+
+    EXPECT_DOUBLE_EQ(process.GetPedestalMean(1), 250);
+    EXPECT_DOUBLE_EQ(process.GetPedestalSigma(1), 2);
+    EXPECT_DOUBLE_EQ(process.GetPedestalMean(3), 100);
+    EXPECT_DOUBLE_EQ(process.GetPedestalSigma(3), 2);
+    EXPECT_LT(process.GetPedestalSigma(2), 0);
+    EXPECT_LT(process.GetPedestalSigma(7), 0);
+
+    // channel 1 uses its pedestal, even if the baseline range of the event is shifted, while channel 2
+    // falls back to the baseline range of the event
+    TRestRawSignalEvent event;
+    TRestRawSignal signal = makeSignal(1, 250, true, 10);
+    TRestRawSignal otherSignal = makeSignal(2, 500, true);
+    event.AddSignal(signal);
+    event.AddSignal(otherSignal);
+    const auto output = (TRestDetectorSignalEvent*)process.ProcessEvent(&event);
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(output->GetNumberOfSignals(), 2);
+    const Double_t baseLines[] = {250, 500};
+    for (int n = 0; n < 2; n++) {
+        const auto signal = output->GetSignal(n);
+        const TRestRawSignal* rawSignal = event.GetSignal(n);
+        ASSERT_EQ(signal->GetNumberOfPoints(), 20);
+        for (int i = 0; i < signal->GetNumberOfPoints(); i++) {
+            const Int_t p = 200 + i;
+            EXPECT_NEAR(signal->GetTime(i), 0.1 * p, 1E-4);
+            EXPECT_EQ(signal->GetData(i), rawSignal->GetRawData(p) - baseLines[n]);
+        }
+    }
+    output->Initialize();
+
+    // the pedestal follows a drift of the baseline to 254, the pulse samples are not used
+    writeConfig(0.5);
+    TRestRawToDetectorSignalProcess updateProcess(configFile.c_str());
+    updateProcess.InitProcess();
+    for (const Double_t expected : {252.0, 253.0, 253.5}) {
+        TRestRawSignalEvent driftEvent;
+        TRestRawSignal driftSignal = makeSignal(1, 254, true);
+        driftEvent.AddSignal(driftSignal);
+        updateProcess.ProcessEvent(&driftEvent);
+        EXPECT_DOUBLE_EQ(updateProcess.GetPedestalMean(1), expected);
+        EXPECT_DOUBLE_EQ(updateProcess.GetPedestalSigma(1), 2);
+        ((TRestDetectorSignalEvent*)updateProcess.GetOutputEvent())->Initialize();
+    }
+    // the other channels and the other instances keep the pedestal run values
+    EXPECT_DOUBLE_EQ(updateProcess.GetPedestalMean(3), 100);
+    EXPECT_DOUBLE_EQ(process.GetPedestalMean(1), 250);
+}
+
+TEST(TRestRawToDetectorSignalProcess, Pulses) {
+    // two pulses over a zero baseline, whose peaks are at bins 102 and 301
+    TRestRawSignal rawSignal;
+    rawSignal.SetSignalID(4);
+    for (int p = 0; p < 512; p++) {
+        Short_t sample = 0;
+        if (p >= 100 && p < 105) {
+            sample = vector<Short_t>({10, 40, 80, 60, 20})[p - 100];
+        } else if (p >= 300 && p < 303) {
+            sample = vector<Short_t>({50, 100, 30})[p - 300];
+        }
+        rawSignal.AddPoint(sample);
+    }
+    TRestRawSignalEvent event;
+    event.AddSignal(rawSignal);
+
+    const string configFile = "rawToSignalPulses.rml";
+    const auto processPulses = [&](const string& pulseTime, const string& pulseAmplitude,
+                                   vector<Double_t>& times, vector<Double_t>& values) {
+        ofstream(configFile) << "<TRestRawToDetectorSignalProcess name=\"pulses\">\n"
+                             << "    <parameter name=\"gain\" value=\"2\"/>\n"
+                             << "    <parameter name=\"pulseMode\" value=\"true\"/>\n"
+                             << "    <parameter name=\"pulseTime\" value=\"" << pulseTime << "\"/>\n"
+                             << "    <parameter name=\"constantFraction\" value=\"0.25\"/>\n"
+                             << "    <parameter name=\"pulseAmplitude\" value=\"" << pulseAmplitude
+                             << "\"/>\n"
+                             << "</TRestRawToDetectorSignalProcess>\n";
+        TRestRawToDetectorSignalProcess process(configFile.c_str());
+        process.InitProcess();
+        const auto output = (TRestDetectorSignalEvent*)process.ProcessEvent(&event);
+        ASSERT_TRUE(output != nullptr);
+        ASSERT_EQ(output->GetNumberOfSignals(), 1);
+        const auto signal = output->GetSignal(0);
+        EXPECT_EQ(signal->GetID(), 4);
+        times.clear();
+        values.clear();
+        for (int i = 0; i < signal->GetNumberOfPoints(); i++) {
+            times.push_back(signal->GetTime(i));
+            values.push_back(signal->GetData(i));
+        }
+
+        // the pulses are 5 and 3 samples long, with the default sampling of 0.1 us
+        EXPECT_EQ(process.GetNPulses(), 2);
+        EXPECT_DOUBLE_EQ(process.GetMeanPulseWidth(), 0.4);
+    };
+
+    vector<Double_t> times;
+    vector<Double_t> values;
+    processPulses("peak", "amplitude", times, values);
+    ASSERT_EQ(times.size(), 2);
+    EXPECT_NEAR(times[0], 10.2, 1E-5);
+    EXPECT_NEAR(times[1], 30.1, 1E-5);
+    EXPECT_EQ(values[0], 2 * 80);
+    EXPECT_EQ(values[1], 2 * 100);
+
+    processPulses("peak", "integral", times, values);
+    ASSERT_EQ(times.size(), 2);
+    EXPECT_NEAR(times[0], 10.2, 1E-5);
+    EXPECT_NEAR(times[1], 30.1, 1E-5);
+    EXPECT_EQ(values[0], 2 * 210);
+    EXPECT_EQ(values[1], 2 * 180);
+
+    // the leading edges cross a quarter of the amplitude (20 and 25) between the bins 100 and 101, and
+    // between the bins 299 and 300
+    processPulses("constantFraction", "amplitude", times, values);
+    ASSERT_EQ(times.size(), 2);
+    EXPECT_NEAR(times[0], 0.1 * (100 + (20.0 - 10) / (40 - 10)), 1E-5);
+    EXPECT_NEAR(times[1], 0.1 * (299 + 25.0 / 50), 1E-5);
+    EXPECT_EQ(values[0], 2 * 80);
+    EXPECT_EQ(values[1], 2 * 100);
+}